@@ -14,7 +14,8 @@ GLFWwindow* window;
 #include <glm/gtc/matrix_transform.hpp>
 using namespace glm;
 
-#include <common/shader.hpp>
+#include <common/program_cache.hpp>
+#include <common/mesh_file.hpp>
 
 int main( void )
 {
@@ -62,12 +63,18 @@ int main( void )
 	// Accept fragment if it closer to the camera than the former one
 	glDepthFunc(GL_LESS); 
 
+	// Cull triangles which normal is not towards the camera; mesh_builder
+	// winds the hamster counterclockwise seen from outside
+	glEnable(GL_CULL_FACE);
+
 	GLuint VertexArrayID;
 	glGenVertexArrays(1, &VertexArrayID);
 	glBindVertexArray(VertexArrayID);
 
 	// Create and compile our GLSL program from the shaders
-	GLuint programID = LoadShaders( "/home/imroggen/OpenGL/ogl-master/tutorial04_colored_cube/TransformVertexShader.vertexshader", "/home/imroggen/OpenGL/ogl-master/tutorial04_colored_cube/ColorFragmentShader.fragmentshader" );
+	// Shaders are looked up next to the executable, or under $OGL_RESOURCE_DIR
+	GLuint programID = LoadShadersCached( resourcePath("TransformVertexShader.vertexshader").c_str(), resourcePath("ColorFragmentShader.fragmentshader").c_str() );
+	printShaderCacheStats();
 
 	// Get a handle for our "MVP" uniform
 	GLuint MatrixID = glGetUniformLocation(programID, "MVP");
@@ -85,493 +92,42 @@ int main( void )
 	// Our ModelViewProjection : multiplication of our 3 matrices
 	glm::mat4 MVP        = Projection * View * Model; // Remember, matrix multiplication is the other way around
 
-	// Our vertices. Tree consecutive floats give a 3D vertex; Three consecutive vertices give a triangle.
-	// A cube has 6 faces with 2 triangles each, so this makes 6*2=12 triangles, and 12*3 vertices
-	static const GLfloat g_vertex_buffer_data2[] = {
-		-1.0f,-1.0f,-1.0f,
-		-1.0f,-1.0f, 1.0f,
-		-1.0f, 1.0f, 1.0f,
-		//1
-		 1.0f, 1.0f,-1.0f,
-		-1.0f,-1.0f,-1.0f,
-		-1.0f, 1.0f,-1.0f,
-		//2
-		 1.0f,-1.0f, 1.0f,
-		-1.0f,-1.0f,-1.0f,
-		 1.0f,-1.0f,-1.0f,
-		 //3
-		 1.0f, 1.0f,-1.0f,
-		 1.0f,-1.0f,-1.0f,
-		-1.0f,-1.0f,-1.0f,
-		//4
-		-1.0f,-1.0f,-1.0f,
-		-1.0f, 1.0f, 1.0f,
-		-1.0f, 1.0f,-1.0f,
-		//5
-		 1.0f,-1.0f, 1.0f,
-		-1.0f,-1.0f, 1.0f,
-		-1.0f,-1.0f,-1.0f,
-		//6
-		-1.0f, 1.0f, 1.0f,
-		-1.0f,-1.0f, 1.0f,
-		 1.0f,-1.0f, 1.0f,
-		 //7
-		 1.0f, 1.0f, 1.0f,
-		 1.0f,-1.0f,-1.0f,
-		 1.0f, 1.0f,-1.0f,
-		 //8
-		 1.0f,-1.0f,-1.0f,
-		 1.0f, 1.0f, 1.0f,
-		 1.0f,-1.0f, 1.0f,
-		 //9
-		 1.0f, 1.0f, 1.0f,
-		 1.0f, 1.0f,-1.0f,
-		-1.0f, 1.0f,-1.0f,
-		//10
-		 1.0f, 1.0f, 1.0f,
-		-1.0f, 1.0f,-1.0f,
-		-1.0f, 1.0f, 1.0f,
-		//11
-		 1.0f, 1.0f, 1.0f,
-		-1.0f, 1.0f, 1.0f,
-		 1.0f,-1.0f, 1.0f
-		 //12
-	};
-	static const GLfloat g_vertex_buffer_data[]{
-            0.0f,0.0f,0.0f,
-            0.0f,3.0f,3.0f,
-            0.0f,0.0f,3.0f,
-            0.0f,0.0f,0.0f,
-            0.0f,3.0f,3.0f,
-            0.0f,3.0f,0.0f,
-            0.0f,0.0f,0.0f,
-            8.0f,0.0f,3.0f,
-            8.0f,0.0f,0.0f,
-            0.0f,0.0f,0.0f,
-            8.0f,0.0f,3.0f,
-            0.0f,0.0f,3.0f,
-            0.0f,0.0f,0.0f,
-            8.0f,3.0f,0.0f,
-            0.0f,3.0f,0.0f,
-            0.0f,0.0f,0.0f,
-            8.0f,3.0f,0.0f,
-            8.0f,0.0f,0.0f,
-            0.0f,0.0f,3.0f,
-            8.0f,3.0f,3.0f,
-            0.0f,3.0f,3.0f,
-            0.0f,0.0f,3.0f,
-            8.0f,3.0f,3.0f,
-            8.0f,0.0f,3.0f,
-            0.0f,3.0f,0.0f,
-            8.0f,3.0f,3.0f,
-            8.0f,3.0f,0.0f,
-            0.0f,3.0f,0.0f,
-            8.0f,3.0f,3.0f,
-            0.0f,3.0f,3.0f,
-            8.0f,0.0f,0.0f,
-            8.0f,3.0f,3.0f,
-            8.0f,0.0f,3.0f,
-            8.0f,0.0f,0.0f,
-            8.0f,3.0f,3.0f,
-            8.0f,3.0f,0.0f,
-            7.0f,0.0f,3.0f,
-            7.0f,3.0f,6.0f,
-            7.0f,0.0f,6.0f,
-            7.0f,0.0f,3.0f,
-            7.0f,3.0f,6.0f,
-            7.0f,3.0f,3.0f,
-            7.0f,0.0f,3.0f,
-            11.0f,0.0f,6.0f,
-            11.0f,0.0f,3.0f,
-            7.0f,0.0f,3.0f,
-            11.0f,0.0f,6.0f,
-            7.0f,0.0f,6.0f,
-            7.0f,0.0f,3.0f,
-            11.0f,3.0f,3.0f,
-            7.0f,3.0f,3.0f,
-            7.0f,0.0f,3.0f,
-            11.0f,3.0f,3.0f,
-            11.0f,0.0f,3.0f,
-            7.0f,0.0f,6.0f,
-            11.0f,3.0f,6.0f,
-            7.0f,3.0f,6.0f,
-            7.0f,0.0f,6.0f,
-            11.0f,3.0f,6.0f,
-            11.0f,0.0f,6.0f,
-            7.0f,3.0f,3.0f,
-            11.0f,3.0f,6.0f,
-            11.0f,3.0f,3.0f,
-            7.0f,3.0f,3.0f,
-            11.0f,3.0f,6.0f,
-            7.0f,3.0f,6.0f,
-            11.0f,0.0f,3.0f,
-            11.0f,3.0f,6.0f,
-            11.0f,0.0f,6.0f,
-            11.0f,0.0f,3.0f,
-            11.0f,3.0f,6.0f,
-            11.0f,3.0f,3.0f,
-            7.0f,0.0f,6.0f,
-            7.0f,1.0f,7.0f,
-            7.0f,0.0f,7.0f,
-            7.0f,0.0f,6.0f,
-            7.0f,1.0f,7.0f,
-            7.0f,1.0f,6.0f,
-            7.0f,0.0f,6.0f,
-            8.0f,0.0f,7.0f,
-            8.0f,0.0f,6.0f,
-            7.0f,0.0f,6.0f,
-            8.0f,0.0f,7.0f,
-            7.0f,0.0f,7.0f,
-            7.0f,0.0f,6.0f,
-            8.0f,1.0f,6.0f,
-            7.0f,1.0f,6.0f,
-            7.0f,0.0f,6.0f,
-            8.0f,1.0f,6.0f,
-            8.0f,0.0f,6.0f,
-            7.0f,0.0f,7.0f,
-            8.0f,1.0f,7.0f,
-            7.0f,1.0f,7.0f,
-            7.0f,0.0f,7.0f,
-            8.0f,1.0f,7.0f,
-            8.0f,0.0f,7.0f,
-            7.0f,1.0f,6.0f,
-            8.0f,1.0f,7.0f,
-            8.0f,1.0f,6.0f,
-            7.0f,1.0f,6.0f,
-            8.0f,1.0f,7.0f,
-            7.0f,1.0f,7.0f,
-            8.0f,0.0f,6.0f,
-            8.0f,1.0f,7.0f,
-            8.0f,0.0f,7.0f,
-            8.0f,0.0f,6.0f,
-            8.0f,1.0f,7.0f,
-            8.0f,1.0f,6.0f,
-            7.0f,2.0f,6.0f,
-            7.0f,3.0f,7.0f,
-            7.0f,2.0f,7.0f,
-            7.0f,2.0f,6.0f,
-            7.0f,3.0f,7.0f,
-            7.0f,3.0f,6.0f,
-            7.0f,2.0f,6.0f,
-            8.0f,2.0f,7.0f,
-            8.0f,2.0f,6.0f,
-            7.0f,2.0f,6.0f,
-            8.0f,2.0f,7.0f,
-            7.0f,2.0f,7.0f,
-            7.0f,2.0f,6.0f,
-            8.0f,3.0f,6.0f,
-            7.0f,3.0f,6.0f,
-            7.0f,2.0f,6.0f,
-            8.0f,3.0f,6.0f,
-            8.0f,2.0f,6.0f,
-            7.0f,2.0f,7.0f,
-            8.0f,3.0f,7.0f,
-            7.0f,3.0f,7.0f,
-            7.0f,2.0f,7.0f,
-            8.0f,3.0f,7.0f,
-            8.0f,2.0f,7.0f,
-            7.0f,3.0f,6.0f,
-            8.0f,3.0f,7.0f,
-            8.0f,3.0f,6.0f,
-            7.0f,3.0f,6.0f,
-            8.0f,3.0f,7.0f,
-            7.0f,3.0f,7.0f,
-            8.0f,2.0f,6.0f,
-            8.0f,3.0f,7.0f,
-            8.0f,2.0f,7.0f,
-            8.0f,2.0f,6.0f,
-            8.0f,3.0f,7.0f,
-            8.0f,3.0f,6.0f,
-            -1.0f,1.0f,2.0f,
-            -1.0f,2.0f,3.0f,
-            -1.0f,1.0f,3.0f,
-            -1.0f,1.0f,2.0f,
-            -1.0f,2.0f,3.0f,
-            -1.0f,2.0f,2.0f,
-            -1.0f,1.0f,2.0f,
-            0.0f,1.0f,3.0f,
-            0.0f,1.0f,2.0f,
-            -1.0f,1.0f,2.0f,
-            0.0f,1.0f,3.0f,
-            -1.0f,1.0f,3.0f,
-            -1.0f,1.0f,2.0f,
-            0.0f,2.0f,2.0f,
-            -1.0f,2.0f,2.0f,
-            -1.0f,1.0f,2.0f,
-            0.0f,2.0f,2.0f,
-            0.0f,1.0f,2.0f,
-            -1.0f,1.0f,3.0f,
-            0.0f,2.0f,3.0f,
-            -1.0f,2.0f,3.0f,
-            -1.0f,1.0f,3.0f,
-            0.0f,2.0f,3.0f,
-            0.0f,1.0f,3.0f,
-            -1.0f,2.0f,2.0f,
-            0.0f,2.0f,3.0f,
-            0.0f,2.0f,2.0f,
-            -1.0f,2.0f,2.0f,
-            0.0f,2.0f,3.0f,
-            -1.0f,2.0f,3.0f,
-            0.0f,1.0f,2.0f,
-            0.0f,2.0f,3.0f,
-            0.0f,1.0f,3.0f,
-            0.0f,1.0f,2.0f,
-            0.0f,2.0f,3.0f,
-            0.0f,2.0f,2.0f,
-            7.0f,0.0f,-1.0f,
-            7.0f,1.0f,0.0f,
-            7.0f,0.0f,0.0f,
-            7.0f,0.0f,-1.0f,
-            7.0f,1.0f,0.0f,
-            7.0f,1.0f,-1.0f,
-            7.0f,0.0f,-1.0f,
-            8.0f,0.0f,0.0f,
-            8.0f,0.0f,-1.0f,
-            7.0f,0.0f,-1.0f,
-            8.0f,0.0f,0.0f,
-            7.0f,0.0f,0.0f,
-            7.0f,0.0f,-1.0f,
-            8.0f,1.0f,-1.0f,
-            7.0f,1.0f,-1.0f,
-            7.0f,0.0f,-1.0f,
-            8.0f,1.0f,-1.0f,
-            8.0f,0.0f,-1.0f,
-            7.0f,0.0f,0.0f,
-            8.0f,1.0f,0.0f,
-            7.0f,1.0f,0.0f,
-            7.0f,0.0f,0.0f,
-            8.0f,1.0f,0.0f,
-            8.0f,0.0f,0.0f,
-            7.0f,1.0f,-1.0f,
-            8.0f,1.0f,0.0f,
-            8.0f,1.0f,-1.0f,
-            7.0f,1.0f,-1.0f,
-            8.0f,1.0f,0.0f,
-            7.0f,1.0f,0.0f,
-            8.0f,0.0f,-1.0f,
-            8.0f,1.0f,0.0f,
-            8.0f,0.0f,0.0f,
-            8.0f,0.0f,-1.0f,
-            8.0f,1.0f,0.0f,
-            8.0f,1.0f,-1.0f,
-            7.0f,2.0f,-1.0f,
-            7.0f,3.0f,0.0f,
-            7.0f,2.0f,0.0f,
-            7.0f,2.0f,-1.0f,
-            7.0f,3.0f,0.0f,
-            7.0f,3.0f,-1.0f,
-            7.0f,2.0f,-1.0f,
-            8.0f,2.0f,0.0f,
-            8.0f,2.0f,-1.0f,
-            7.0f,2.0f,-1.0f,
-            8.0f,2.0f,0.0f,
-            7.0f,2.0f,0.0f,
-            7.0f,2.0f,-1.0f,
-            8.0f,3.0f,-1.0f,
-            7.0f,3.0f,-1.0f,
-            7.0f,2.0f,-1.0f,
-            8.0f,3.0f,-1.0f,
-            8.0f,2.0f,-1.0f,
-            7.0f,2.0f,0.0f,
-            8.0f,3.0f,0.0f,
-            7.0f,3.0f,0.0f,
-            7.0f,2.0f,0.0f,
-            8.0f,3.0f,0.0f,
-            8.0f,2.0f,0.0f,
-            7.0f,3.0f,-1.0f,
-            8.0f,3.0f,0.0f,
-            8.0f,3.0f,-1.0f,
-            7.0f,3.0f,-1.0f,
-            8.0f,3.0f,0.0f,
-            7.0f,3.0f,0.0f,
-            8.0f,2.0f,-1.0f,
-            8.0f,3.0f,0.0f,
-            8.0f,2.0f,0.0f,
-            8.0f,2.0f,-1.0f,
-            8.0f,3.0f,0.0f,
-            8.0f,3.0f,-1.0f,
-            0.0f,2.0f,-1.0f,
-            0.0f,3.0f,0.0f,
-            0.0f,2.0f,0.0f,
-            0.0f,2.0f,-1.0f,
-            0.0f,3.0f,0.0f,
-            0.0f,3.0f,-1.0f,
-            0.0f,2.0f,-1.0f,
-            1.0f,2.0f,0.0f,
-            1.0f,2.0f,-1.0f,
-            0.0f,2.0f,-1.0f,
-            1.0f,2.0f,0.0f,
-            0.0f,2.0f,0.0f,
-            0.0f,2.0f,-1.0f,
-            1.0f,3.0f,-1.0f,
-            0.0f,3.0f,-1.0f,
-            0.0f,2.0f,-1.0f,
-            1.0f,3.0f,-1.0f,
-            1.0f,2.0f,-1.0f,
-            0.0f,2.0f,0.0f,
-            1.0f,3.0f,0.0f,
-            0.0f,3.0f,0.0f,
-            0.0f,2.0f,0.0f,
-            1.0f,3.0f,0.0f,
-            1.0f,2.0f,0.0f,
-            0.0f,3.0f,-1.0f,
-            1.0f,3.0f,0.0f,
-            1.0f,3.0f,-1.0f,
-            0.0f,3.0f,-1.0f,
-            1.0f,3.0f,0.0f,
-            0.0f,3.0f,0.0f,
-            1.0f,2.0f,-1.0f,
-            1.0f,3.0f,0.0f,
-            1.0f,2.0f,0.0f,
-            1.0f,2.0f,-1.0f,
-            1.0f,3.0f,0.0f,
-            1.0f,3.0f,-1.0f,
-            0.0f,0.0f,-1.0f,
-            0.0f,1.0f,0.0f,
-            0.0f,0.0f,0.0f,
-            0.0f,0.0f,-1.0f,
-            0.0f,1.0f,0.0f,
-            0.0f,1.0f,-1.0f,
-            0.0f,0.0f,-1.0f,
-            1.0f,0.0f,0.0f,
-            1.0f,0.0f,-1.0f,
-            0.0f,0.0f,-1.0f,
-            1.0f,0.0f,0.0f,
-            0.0f,0.0f,0.0f,
-            0.0f,0.0f,-1.0f,
-            1.0f,1.0f,-1.0f,
-            0.0f,1.0f,-1.0f,
-            0.0f,0.0f,-1.0f,
-            1.0f,1.0f,-1.0f,
-            1.0f,0.0f,-1.0f,
-            0.0f,0.0f,0.0f,
-            1.0f,1.0f,0.0f,
-            0.0f,1.0f,0.0f,
-            0.0f,0.0f,0.0f,
-            1.0f,1.0f,0.0f,
-            1.0f,0.0f,0.0f,
-            0.0f,1.0f,-1.0f,
-            1.0f,1.0f,0.0f,
-            1.0f,1.0f,-1.0f,
-            0.0f,1.0f,-1.0f,
-            1.0f,1.0f,0.0f,
-            0.0f,1.0f,0.0f,
-            1.0f,0.0f,-1.0f,
-            1.0f,1.0f,0.0f,
-            1.0f,0.0f,0.0f,
-            1.0f,0.0f,-1.0f,
-            1.0f,1.0f,0.0f,
-            1.0f,1.0f,-1.0f
-	};
-
-
-	// One color for each vertex. They were generated randomly.
-	static const GLfloat g_color_buffer_data[] = {
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.84,0,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-            1,0.9,0.05,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-
-            0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,0.32, 0.26, 0.1,
-	};
+	// The hamster is built from boxes by tools/mesh_builder; the file is
+	// mapped and its arrays go to the GPU as they are. Boxes share corners,
+	// so every vertex is stored and shaded once and the triangles index them.
+	MeshFile hamster(resourcePath("hamster.mesh"));
+	if (!hamster.valid()) {
+		fprintf(stderr, "Failed to load hamster.mesh\n");
+		getchar();
+		glfwTerminate();
+		return -1;
+	}
 
 	GLuint vertexbuffer;
 	glGenBuffers(1, &vertexbuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, 3 * sizeof(GLfloat) * hamster.vertex_count(), hamster.positions(), GL_STATIC_DRAW);
+
+	// The vertex array object remembers the index buffer
+	GLuint elementbuffer;
+	glGenBuffers(1, &elementbuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * hamster.index_count(), hamster.indices(), GL_STATIC_DRAW);
+
+	// Drawn without indices, with a color per vertex, it took a position and
+	// a color for every corner of the 12 triangles of each of its 9 boxes
+	constexpr size_t NAIVE_VERTICES = 12 * 9 * 3;
+	printf("hamster: %zu vertices, %zu bytes (was %zu vertices, %zu bytes)\n",
+	       hamster.vertex_count(), 3 * sizeof(GLfloat) * hamster.vertex_count() + sizeof(GLuint) * hamster.index_count(),
+	       NAIVE_VERTICES, 6 * sizeof(GLfloat) * NAIVE_VERTICES);
+
+	// Counts how often the vertex shader really runs in the first frame
+	GLuint invocationsQuery = 0;
+	if (GLEW_ARB_pipeline_statistics_query) {
+		glGenQueries(1, &invocationsQuery);
+	}
+	bool firstFrame = true;
 
-	GLuint colorbuffer;
-	glGenBuffers(1, &colorbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, colorbuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(g_color_buffer_data), g_color_buffer_data, GL_STATIC_DRAW);
     float radius = 30;
 	do{
 
@@ -606,23 +162,25 @@ int main( void )
 			(void*)0            // array buffer offset
 		);
 
-		// 2nd attribute buffer : colors
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, colorbuffer);
-		glVertexAttribPointer(
-			1,                                // attribute. No particular reason for 1, but must match the layout in the shader.
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// Draw the triangle !
-		glDrawArrays(GL_TRIANGLES, 0, 12*9*3); // 12*3 indices starting at 0 -> 12 triangles
+		// Every part in its own color, one constant attribute per draw
+		// instead of a color in every vertex
+		if (firstFrame && invocationsQuery != 0) {
+			glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, invocationsQuery);
+		}
+		for (size_t p = 0; p < hamster.part_count(); p++) {
+			const mesh_file::Part& part = hamster.parts()[p];
+			glVertexAttrib3fv(1, part.color);
+			glDrawElements(GL_TRIANGLES, part.index_count, GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * part.first_index));
+		}
+		if (firstFrame && invocationsQuery != 0) {
+			glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+			GLuint invocations = 0;
+			glGetQueryObjectuiv(invocationsQuery, GL_QUERY_RESULT, &invocations);
+			printf("hamster: %u vertex shader runs a frame (was %zu)\n", invocations, NAIVE_VERTICES);
+		}
+		firstFrame = false;
 
 		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
 
 		// Swap buffers
 		glfwSwapBuffers(window);
@@ -634,7 +192,10 @@ int main( void )
 
 	// Cleanup VBO and shader
 	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &colorbuffer);
+	glDeleteBuffers(1, &elementbuffer);
+	if (invocationsQuery != 0) {
+		glDeleteQueries(1, &invocationsQuery);
+	}
 	glDeleteProgram(programID);
 	glDeleteVertexArrays(1, &VertexArrayID);
 
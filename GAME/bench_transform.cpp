@@ -0,0 +1,198 @@
+// Microbenchmark of the batch transform kernels against the old per-triangle code.
+// Every variant stretches, turns and moves `copies` cats, starting from the
+// same positions on every run, and each kernel is checked against the old
+// code before it is timed.
+//
+// Usage: bench_transform [copies] [repeats]
+
+// Include standard headers
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+// Include GLM
+#include <glm/glm.hpp>
+
+#include "objects.hpp"
+#include "transform_kernels.hpp"
+
+
+// The Triangle the game used before Mesh: one heap vector per triangle
+// and six sin/cos calls every time a triangle is turned.
+class LegacyTriangle {
+    std::vector<glm::vec3> points;
+
+public:
+    explicit LegacyTriangle(const std::vector<glm::vec3>& points) : points(points) {}
+
+    const std::vector<glm::vec3>& get_points() const {
+        return points;
+    }
+
+    void move(const glm::vec3& shift) {
+        for (auto& point : points) {
+            point += shift;
+        }
+    }
+
+    void stretch(GLfloat alpha) {
+        for (auto& point : points) {
+            point *= alpha;
+        }
+    }
+
+    void turn(const glm::vec3& angle) {
+        GLfloat sin1 = sin(angle.x);
+        GLfloat cos1 = cos(angle.x);
+        GLfloat sin2 = sin(angle.y);
+        GLfloat cos2 = cos(angle.y);
+        GLfloat sin3 = sin(angle.z);
+        GLfloat cos3 = cos(angle.z);
+
+        for (auto& point : points) {
+            glm::vec3 new_point;
+            new_point.x = point.x * cos1 - point.y * sin1;
+            new_point.y = point.x * sin1 + point.y * cos1;
+            new_point.z = point.z;
+            point = new_point;
+            new_point.x = point.x * cos2 - point.z * sin2;
+            new_point.z = point.x * sin2 + point.z * cos2;
+            new_point.y = point.y;
+            point = new_point;
+            new_point.x = point.x * cos3 - point.y * sin3;
+            new_point.y = point.x * sin3 + point.y * cos3;
+            new_point.z = point.z;
+            point = new_point;
+        }
+    }
+};
+
+
+typedef std::chrono::steady_clock Clock;
+
+// Best time of function over the repeats; reset puts the input back before
+// every run and is not timed, so each run starts from the same values.
+template <typename R, typename F>
+double best_ns(size_t repeats, R reset, F function) {
+    double best = 1e300;
+    for (size_t r = 0; r < repeats; ++r) {
+        reset();
+        auto start = Clock::now();
+        function();
+        best = std::min(best, (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+// Largest difference between a result and the legacy one, per coordinate
+GLfloat max_error(const std::vector<LegacyTriangle>& legacy, const Mesh& result) {
+    GLfloat error = 0;
+    size_t i = 0;
+    for (const auto& triangle : legacy) {
+        for (const auto& point : triangle.get_points()) {
+            glm::vec3 difference = glm::abs(point - result.point(i++));
+            error = std::max(error, std::max(difference.x, std::max(difference.y, difference.z)));
+        }
+    }
+    return error;
+}
+
+
+int main(int argc, char** argv) {
+    size_t copies = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+    size_t repeats = argc > 2 ? strtoul(argv[2], NULL, 10) : 20;
+
+    const glm::vec3 angle(0.3f, 1.1f, 2.5f);
+    const glm::vec3 shift(1.0f, 2.0f, 3.0f);
+    const GLfloat radius = 0.13f;
+    // Single precision, values of a few units and a different order of operations
+    const GLfloat tolerance = 1e-4f;
+    const Mesh& cat = cat_mesh();
+    const size_t vertices = copies * cat.size();
+
+    std::vector<LegacyTriangle> source;
+    for (size_t copy = 0; copy < copies; ++copy) {
+        for (size_t i = 0; i < cat.size(); i += 3) {
+            source.emplace_back(std::vector<glm::vec3>{
+                    cat.point(i), cat.point(i + 1), cat.point(i + 2)
+            });
+        }
+    }
+    std::vector<LegacyTriangle> legacy = source;
+
+    Mesh input;
+    input.reserve(vertices);
+    for (size_t copy = 0; copy < copies; ++copy) {
+        for (size_t i = 0; i < cat.size(); ++i) {
+            input.add_vertex(cat.point(i));
+        }
+    }
+    Mesh batch = input;
+
+    printf("%zu cats, %zu vertices, best of %zu runs\n", copies, vertices, repeats);
+
+    auto run_legacy = [&]() {
+        for (auto& triangle : legacy) {
+            triangle.stretch(radius);
+            triangle.turn(angle);
+            triangle.move(shift);
+        }
+    };
+    double legacy_ns = best_ns(repeats, [&]() { legacy = source; }, run_legacy);
+    printf("%-22s %10.2f ns/vertex\n", "per-triangle (legacy)", legacy_ns / vertices);
+    // The reference every kernel has to match
+    legacy = source;
+    run_legacy();
+
+    auto reset = [&]() {
+        std::copy(input.x.begin(), input.x.end(), batch.x.begin());
+        std::copy(input.y.begin(), input.y.end(), batch.y.begin());
+        std::copy(input.z.begin(), input.z.end(), batch.z.begin());
+    };
+    bool correct = true;
+    for (int isa = 0; isa < Kernels::ISA_COUNT; ++isa) {
+        if (!Kernels::supported((Kernels::Isa)isa)) {
+            printf("%-22s %10s\n", Kernels::ISA_NAMES[isa], "unsupported");
+            continue;
+        }
+        const Kernels::KernelSet& kernels = Kernels::kernels((Kernels::Isa)isa);
+        GLfloat* x = batch.x.data();
+        GLfloat* y = batch.y.data();
+        GLfloat* z = batch.z.data();
+
+        // Separate passes for the scale, the turn and the shift, as the legacy code does them
+        auto separate = [&]() {
+            kernels.scale(x, y, z, vertices, radius);
+            kernels.transform(x, y, z, x, y, z, vertices, Kernels::euler_rotation(angle), glm::vec3(0, 0, 0));
+            kernels.translate(x, y, z, vertices, shift);
+        };
+        // One fused pass with the scale folded into the matrix, from the input
+        auto fused = [&]() {
+            kernels.transform(input.x.data(), input.y.data(), input.z.data(), x, y, z, vertices,
+                              Kernels::euler_rotation(angle) * radius, shift);
+        };
+
+        reset();
+        separate();
+        GLfloat separate_error = max_error(legacy, batch);
+        reset();
+        fused();
+        GLfloat fused_error = max_error(legacy, batch);
+        if (separate_error > tolerance || fused_error > tolerance) {
+            printf("%-22s differs from legacy by %g (separate), %g (fused)\n", Kernels::ISA_NAMES[isa],
+                   separate_error, fused_error);
+            correct = false;
+            continue;
+        }
+
+        double separate_ns = best_ns(repeats, reset, separate);
+        double fused_ns = best_ns(repeats, reset, fused);
+        printf("%-22s %10.2f ns/vertex (x%.1f), fused %.2f ns/vertex (x%.1f)\n",
+               Kernels::ISA_NAMES[isa],
+               separate_ns / vertices, legacy_ns / separate_ns,
+               fused_ns / vertices, legacy_ns / fused_ns);
+    }
+    return correct ? 0 : 1;
+}
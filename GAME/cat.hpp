@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "common/box_mesh.hpp"
+
+// The cat every target is, made out of boxes at compile time: the box
+// mesher runs in constant evaluation and the triangles land in read-only
+// data, laid out the way Mesh keeps them.
+namespace cat {
+
+    enum Part {
+        BODY,
+        HEAD,
+        OTHER,  // ears, tail and legs
+    };
+
+    constexpr box_mesh::Box BOXES[] = {
+        {0, 0, 0, 8, 3, 3, false, BODY},
+        {7, 0, 3, 11, 3, 6, false, HEAD},
+        {7, 0, 6, 8, 1, 7, true, OTHER},  // ears
+        {7, 3, 6, 8, 2, 7, true, OTHER},
+        {-3, 1, 2, 0, 2, 3, false, OTHER},  // tail
+        {-3, 1, 3, -2, 2, 5, false, OTHER},
+        {-4, 1, 4, -3, 2, 5, false, OTHER},
+        {7, 0, -1, 8, 1, 0, false, OTHER},  // legs
+        {7, 2, -1, 8, 3, 0, false, OTHER},
+        {0, 2, -1, 1, 3, 0, false, OTHER},
+        {0, 0, -1, 1, 1, 0, false, OTHER},
+    };
+
+    constexpr size_t BOX_COUNT = sizeof(BOXES) / sizeof(BOXES[0]);
+
+    // Only ever read while compiling
+    constexpr BoxMesh INDEXED = meshBoxes(BOXES, BOX_COUNT);
+    static_assert(INDEXED.valid, "The cat does not fit the box mesher");
+
+    constexpr size_t VERTICES = INDEXED.index_count;
+
+    // Every three vertices a triangle, the closed piece of the boxes every
+    // triangle belongs to, and the box and sphere (around the origin) they fit in
+    struct Triangles {
+        std::array<float, VERTICES> x{};
+        std::array<float, VERTICES> y{};
+        std::array<float, VERTICES> z{};
+        std::array<unsigned char, VERTICES / 3> pieces{};
+        size_t piece_count = 0;
+        std::array<float, 3> min{};
+        std::array<float, 3> max{};
+        float radius = 0;
+    };
+
+    constexpr float root(float squared) {
+        float x = squared > 1 ? squared : 1;
+        for (int i = 0; i < 32; ++i) {
+            x = (x + squared / x) / 2;
+        }
+        return x;
+    }
+
+    constexpr Triangles triangles() {
+        Triangles result;
+        float squared = 0;
+        for (size_t i = 0; i < VERTICES; ++i) {
+            const float* position = INDEXED.positions + 3 * INDEXED.indices[i];
+            result.x[i] = position[0];
+            result.y[i] = position[1];
+            result.z[i] = position[2];
+            result.pieces[i / 3] = INDEXED.pieces[i / 3];
+            for (size_t c = 0; c < 3; ++c) {
+                result.min[c] = i == 0 || position[c] < result.min[c] ? position[c] : result.min[c];
+                result.max[c] = i == 0 || position[c] > result.max[c] ? position[c] : result.max[c];
+            }
+            float distance = position[0] * position[0] + position[1] * position[1] + position[2] * position[2];
+            squared = distance > squared ? distance : squared;
+        }
+        result.radius = root(squared);
+        result.piece_count = INDEXED.piece_count;
+        return result;
+    }
+
+    inline constexpr Triangles TRIANGLES = triangles();
+
+} // namespace cat
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+
+
+// Turns variable frame times into a whole number of fixed simulation ticks.
+// Frame time piles up in an accumulator; every full tick is taken out of it
+// and the remainder says how far the rendered frame lies between two ticks.
+class FixedClock {
+    double _step;
+    double max_frame;
+    double accumulator;
+    size_t _ticks;
+
+public:
+    // Frames longer than max_frame are cut, so that a stall (a breakpoint,
+    // a dragged window) does not make the simulation run hundreds of ticks to catch up.
+    explicit FixedClock(double step=1.0 / 60, double max_frame=0.25)
+    : _step(step), max_frame(max_frame), accumulator(0), _ticks(0) {}
+
+    void advance(double frame_time) {
+        accumulator += std::min(std::max(frame_time, 0.0), max_frame);
+    }
+
+    // Takes one tick out of the accumulator if a full one is there.
+    bool tick() {
+        if (accumulator < _step) {
+            return false;
+        }
+        accumulator -= _step;
+        ++_ticks;
+        return true;
+    }
+
+    // Position of the current frame between the last tick and the next, in [0, 1).
+    float alpha() const {
+        return float(accumulator / _step);
+    }
+
+    double step() const {
+        return _step;
+    }
+
+    size_t ticks() const {
+        return _ticks;
+    }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+
+// The six planes bounding what a camera sees, taken from its
+// projection * view matrix. Normals point inside.
+class Frustum {
+    glm::vec4 planes[6];
+    bool everything;
+    glm::vec3 eye;
+    float focal;  // projection[1][1]: screen half-heights per unit of height at distance 1
+
+public:
+    // A frustum that sees everything, for callers without a camera
+    Frustum() : everything(true), eye(0, 0, 0), focal(0) {}
+
+    // Knows the camera position too, so it can tell how large things look.
+    Frustum(const glm::mat4& projection, const glm::mat4& view) : Frustum(projection * view) {
+        // The camera is at -R^T * t for view = [R t]
+        for (int i = 0; i < 3; ++i) {
+            eye[i] = -(view[i][0] * view[3][0] + view[i][1] * view[3][1] + view[i][2] * view[3][2]);
+        }
+        focal = projection[1][1];
+    }
+
+    explicit Frustum(const glm::mat4& view_projection) : everything(false), eye(0, 0, 0), focal(0) {
+        const glm::mat4& m = view_projection;
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; ++i) {
+            row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        }
+        // -w <= x, y, z <= w in clip space
+        planes[0] = row[3] + row[0];
+        planes[1] = row[3] - row[0];
+        planes[2] = row[3] + row[1];
+        planes[3] = row[3] - row[1];
+        planes[4] = row[3] + row[2];
+        planes[5] = row[3] - row[2];
+        for (auto& plane : planes) {
+            plane = plane * (1.0f / std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z));
+        }
+    }
+
+    // Whether any part of the sphere may be visible
+    bool sees(const glm::vec3& center, float radius) const {
+        if (everything) {
+            return true;
+        }
+        for (const auto& plane : planes) {
+            if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Part of the screen height a sphere covers; without a camera
+    // position everything is taken to fill the screen.
+    float screen_size(const glm::vec3& center, float radius) const {
+        glm::vec3 offset = center - eye;
+        float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+        if (focal == 0 || distance <= radius) {
+            return std::numeric_limits<float>::max();
+        }
+        return radius * focal / distance;
+    }
+};
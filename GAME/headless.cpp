@@ -0,0 +1,375 @@
+// Runs the shooter simulation without a window and reports
+// how long every phase of the frame takes.
+//
+// Usage: headless [frames] [seed] [--csv] [--no-instancing] [--fps=N]
+//                 [--spawn-rate=R] [--fire-cooldown=S] [--threads=N] [--scaling]
+//                 [--no-culling] [--no-lod] [--fireball-range=R] [--render-ms=N]
+//                 [--meshes] [--obj=FILE]
+//
+// --fps sets the simulated render rate (60 by default, one tick per frame);
+// the ticks, and so the world, are the same at any rate.
+// --spawn-rate and --fire-cooldown override the targets spawned per second
+// and the seconds between shots, e.g. --spawn-rate=60 --fire-cooldown=0
+// for a stress scene; --fireball-range lets more fireballs fly at once.
+// --threads sets the number of threads updating and emitting objects,
+// --scaling runs the same scene with 1 to 16 threads and compares frame times.
+// --no-culling emits every object, as if the camera saw the whole world.
+// --no-lod draws every object with its most detailed mesh.
+// --render-ms=N runs in real time with a render thread that takes N ms
+// per frame, like a slow GPU, and compares simulating on that thread
+// with simulating on a thread of its own; frames here are drawn frames.
+// --meshes prints the vertex cache and overdraw figures of the meshes
+// instead (see common/mesh_optimize.hpp).
+// --obj=FILE loads an OBJ model the way the game would, e.g.
+// --obj=3d_hamster/box.obj, checks it is closed and prints the same
+// figures for it; the exit status is 1 if it cannot be used.
+
+// Include standard headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <thread>
+
+// Include GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "objects.hpp"
+#include "simulation.hpp"
+#include "clock.hpp"
+#include "frustum.hpp"
+#include "pipeline.hpp"
+
+
+// Scripted replacement for Controls::computeMatricesFromInputs:
+// the player stands still, keeps turning right and holds the fire button.
+Input scripted_input(size_t tick) {
+    const float C = 90.;
+    float direction_right = -float(tick);
+    float direction_up = 0;
+
+    Input input;
+    input.position = glm::vec3(0, 2, 0);
+    input.direction = glm::vec3(
+            sin(direction_right / C),
+            direction_up / C,
+            cos(direction_right / C)
+    );
+    input.fire = true;
+    return input;
+}
+
+// The camera Controls::computeMatricesFromInputs would set up for input
+Frustum scripted_frustum(const Input& input) {
+    glm::mat4 projection = glm::perspective(45.0f, 4.0f / 3.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(input.position, input.position + input.direction, glm::vec3(0, 1, 0));
+    return Frustum(projection, view);
+}
+
+
+// Average ns per frame of every phase over a whole run
+std::vector<long long> run(size_t frames, unsigned seed, const Settings& settings, bool instancing, double fps,
+                           bool culling) {
+    Simulation simulation(seed, false, settings);
+    Buffer buffer(instancing);
+    FixedClock clock(Simulation::TICK);
+
+    std::vector<long long> total_ns(PHASES_COUNT, 0);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        clock.advance(1 / fps);
+        while (clock.tick()) {
+            simulation.tick(scripted_input(simulation.ticks()));
+        }
+        simulation.emit(buffer, clock.alpha(),
+                        culling ? scripted_frustum(scripted_input(simulation.ticks())) : Frustum());
+        for (int phase = 0; phase < PHASES_COUNT; ++phase) {
+            total_ns[phase] += simulation.stats().phase_ns[phase];
+        }
+    }
+    for (auto& ns : total_ns) {
+        ns /= (long long)std::max<size_t>(frames, 1);
+    }
+    return total_ns;
+}
+
+void print_scaling(size_t frames, unsigned seed, Settings settings, bool instancing, double fps, bool culling) {
+    printf("%-8s %14s %14s %14s %10s\n", "threads", "move ns", "emit ns", "total ns", "speedup");
+    // A first run that is not measured, so that every measured one
+    // finds the heap already grown to the size of the scene
+    settings.threads = 1;
+    run(frames, seed, settings, instancing, fps, culling);
+
+    long long single = 0;
+    for (size_t threads = 1; threads <= 16; threads *= 2) {
+        settings.threads = threads;
+        std::vector<long long> ns = run(frames, seed, settings, instancing, fps, culling);
+        long long total = std::accumulate(ns.begin(), ns.end(), 0LL);
+        if (threads == 1) {
+            single = total;
+        }
+        printf("%-8zu %14lld %14lld %14lld %9.2fx\n", threads, ns[PHASE_MOVE], ns[PHASE_EMIT], total,
+               (double)single / total);
+    }
+}
+
+
+// Frames per second a render thread taking render_ms per frame gets, and how
+// long after reading the input it finishes drawing, pipelined or not. The
+// pipelined render thread draws with the camera it just read, so the camera
+// lags less than the world, which comes from an earlier input.
+void real_time_run(size_t frames, unsigned seed, const Settings& settings, bool instancing, double render_ms,
+                   bool culling, bool pipelined) {
+    Simulation simulation(seed, false, settings);
+    Buffer buffer(instancing);
+    FixedClock clock(Simulation::TICK);
+    std::unique_ptr<FramePipeline> pipeline;
+    if (pipelined) {
+        pipeline.reset(new FramePipeline(simulation, instancing));
+    }
+    const auto render_time = std::chrono::duration<double, std::milli>(render_ms);
+
+    PipelineClock::time_point start = PipelineClock::now();
+    PipelineClock::time_point last = start;
+    double view_latency_total = 0;
+    double latency_total = 0;
+    size_t drawn = 0;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        const Input input = scripted_input(frame);
+        const Frustum frustum = scripted_frustum(input);
+        const PipelineClock::time_point read_time = PipelineClock::now();
+        PipelineClock::time_point input_time = read_time;
+        if (pipeline) {
+            FrameInput frame_input = {
+                    input, culling,
+                    glm::perspective(45.0f, 4.0f / 3.0f, 0.1f, 100.0f),
+                    glm::lookAt(input.position, input.position + input.direction, glm::vec3(0, 1, 0)),
+                    read_time
+            };
+            pipeline->submit(frame_input);
+            const Snapshot* snapshot = pipeline->latest();
+            if (snapshot == NULL) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            input_time = snapshot->input_time;
+        } else {
+            clock.advance(std::chrono::duration<double>(input_time - last).count());
+            last = input_time;
+            while (clock.tick()) {
+                simulation.tick(input);
+            }
+            simulation.emit(buffer, clock.alpha(), culling ? frustum : Frustum());
+        }
+        // The draw and the swap
+        std::this_thread::sleep_for(render_time);
+        const PipelineClock::time_point swapped = PipelineClock::now();
+        view_latency_total += std::chrono::duration<double>(swapped - read_time).count();
+        latency_total += std::chrono::duration<double>(swapped - input_time).count();
+        ++drawn;
+    }
+    double seconds = std::chrono::duration<double>(PipelineClock::now() - start).count();
+    size_t made = pipeline ? pipeline->frames_made() : drawn;
+    pipeline.reset();
+
+    drawn = std::max<size_t>(drawn, 1);
+    printf("%-10s %10.1f %10.1f %10.2f %10.2f %12zu\n", pipelined ? "pipelined" : "serial", drawn / seconds,
+           simulation.ticks() / seconds, view_latency_total * 1e3 / drawn, latency_total * 1e3 / drawn, made);
+}
+
+
+// ACMR with a 16-vertex cache and overdraw of a mesh; without indices
+// every vertex is transformed
+void print_mesh(const char* name, const char* order, const Mesh& mesh) {
+    std::vector<GLushort> indices = mesh.indices;
+    if (indices.empty()) {
+        indices.resize(mesh.size());
+        std::iota(indices.begin(), indices.end(), 0);
+    }
+    const std::vector<float> positions = mesh.positions();
+    VertexCacheStats cache = analyzeVertexCache(indices.data(), indices.size(), mesh.size());
+    OverdrawStats overdraw = analyzeOverdraw(indices.data(), indices.size(), positions.data(), mesh.size());
+    printf("%-12s %-10s %10zu %10.3f %10.3f %10.4f\n", name, order, mesh.triangles_count(), cache.acmr(), cache.atvr(),
+           overdraw.overdraw());
+}
+
+// The meshes in the order they are generated in and as they are drawn
+void print_meshes() {
+    printf("%-12s %-10s %10s %10s %10s %10s\n", "mesh", "order", "triangles", "ACMR", "ATVR", "overdraw");
+    Mesh cat;
+    cat.x.assign(cat::TRIANGLES.x.begin(), cat::TRIANGLES.x.end());
+    cat.y.assign(cat::TRIANGLES.y.begin(), cat::TRIANGLES.y.end());
+    cat.z.assign(cat::TRIANGLES.z.begin(), cat::TRIANGLES.z.end());
+    print_mesh("cat", "generated", cat);
+    print_mesh("cat", "drawn", cat_mesh());
+    print_mesh("far cat", "drawn", *cat_lods().meshes[1]);
+    for (size_t count : {20, 10, 5}) {
+        char name[32];
+        snprintf(name, sizeof(name), "sphere %zu", count);
+        print_mesh(name, "generated", sphere_rings(0.5f, count));
+        print_mesh(name, "drawn", sphere_mesh(0.5f, count));
+    }
+}
+
+// An OBJ model as loaded and as the game would draw it; false if it
+// fails to load or is not closed
+bool print_obj(const char* name) {
+    Mesh mesh;
+    if (!load_obj(name, mesh)) {
+        return false;
+    }
+    printf("%s: %zu vertices, %zu triangles\n", name, mesh.size(), mesh.triangles_count());
+    printf("%-12s %-10s %10s %10s %10s %10s\n", "mesh", "order", "triangles", "ACMR", "ATVR", "overdraw");
+    print_mesh("model", "loaded", mesh);
+    if (!mesh.orient(name).closed()) {
+        return false;
+    }
+    mesh.optimize();
+    print_mesh("model", "drawn", mesh);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t frames = 10000;
+    unsigned seed = std::default_random_engine::default_seed;
+    bool csv = false;
+    bool instancing = true;
+    Settings settings;
+    double fps = 1 / Simulation::TICK;
+    bool scaling = false;
+    bool culling = true;
+    double render_ms = 0;
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "--no-instancing") == 0) {
+            instancing = false;
+        } else if (strcmp(argv[i], "--no-culling") == 0) {
+            culling = false;
+        } else if (strcmp(argv[i], "--no-lod") == 0) {
+            settings.lod = false;
+        } else if (strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if (strcmp(argv[i], "--meshes") == 0) {
+            print_meshes();
+            return 0;
+        } else if (strncmp(argv[i], "--obj=", 6) == 0) {
+            return print_obj(argv[i] + 6) ? 0 : 1;
+        } else if (strncmp(argv[i], "--render-ms=", 12) == 0) {
+            render_ms = strtod(argv[i] + 12, NULL);
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            settings.threads = strtoul(argv[i] + 10, NULL, 10);
+        } else if (strncmp(argv[i], "--fps=", 6) == 0) {
+            fps = strtod(argv[i] + 6, NULL);
+        } else if (strncmp(argv[i], "--spawn-rate=", 13) == 0) {
+            settings.spawn_rate = strtof(argv[i] + 13, NULL);
+        } else if (strncmp(argv[i], "--fire-cooldown=", 16) == 0) {
+            settings.fire_cooldown = strtof(argv[i] + 16, NULL);
+        } else if (strncmp(argv[i], "--fireball-range=", 17) == 0) {
+            settings.fireball_range = strtof(argv[i] + 17, NULL);
+        } else if (argv[i][0] == '-' || positional == 2) {
+            fprintf(stderr,
+                    "Usage: %s [frames] [seed] [--csv] [--no-instancing] [--fps=N]\n"
+                    "       [--spawn-rate=R] [--fire-cooldown=S] [--threads=N] [--scaling]\n"
+                    "       [--no-culling] [--no-lod] [--fireball-range=R] [--render-ms=N]\n"
+                    "       [--meshes] [--obj=FILE]\n", argv[0]);
+            return 1;
+        } else if (positional == 0) {
+            frames = strtoul(argv[i], NULL, 10);
+            ++positional;
+        } else {
+            seed = strtoul(argv[i], NULL, 10);
+            ++positional;
+        }
+    }
+
+    if (scaling) {
+        print_scaling(frames, seed, settings, instancing, fps, culling);
+        return 0;
+    }
+    if (render_ms > 0) {
+        printf("%-10s %10s %10s %10s %10s %12s\n", "mode", "frames/s", "ticks/s", "camera ms", "world ms",
+               "frames made");
+        real_time_run(frames, seed, settings, instancing, render_ms, culling, false);
+        real_time_run(frames, seed, settings, instancing, render_ms, culling, true);
+        return 0;
+    }
+
+    Simulation simulation(seed, false, settings);
+    Buffer buffer(instancing);
+    FixedClock clock(Simulation::TICK);
+
+    std::vector<long long> total_ns(PHASES_COUNT, 0);
+    std::vector<long long> max_ns(PHASES_COUNT, 0);
+    size_t collisions = 0;
+    size_t upload_bytes = 0;
+    size_t collision_checks = 0;
+    size_t culled = 0;
+    size_t triangles = 0;
+
+    if (csv) {
+        printf("frame");
+        for (int phase = 0; phase < PHASES_COUNT; ++phase) {
+            printf(",%s_ns", PHASE_NAMES[phase]);
+        }
+        printf(",ticks,targets,fireballs,vertices,instances,upload_bytes,collision_checks"
+               ",culled_targets,culled_fireballs,triangles\n");
+    }
+
+    for (size_t frame = 0; frame < frames; ++frame) {
+        clock.advance(1 / fps);
+        while (clock.tick()) {
+            simulation.tick(scripted_input(simulation.ticks()));
+        }
+        simulation.emit(buffer, clock.alpha(),
+                        culling ? scripted_frustum(scripted_input(simulation.ticks())) : Frustum());
+
+        const FrameStats& stats = simulation.stats();
+        for (int phase = 0; phase < PHASES_COUNT; ++phase) {
+            total_ns[phase] += stats.phase_ns[phase];
+            max_ns[phase] = std::max(max_ns[phase], stats.phase_ns[phase]);
+        }
+        collisions += stats.has_collision;
+        upload_bytes += stats.upload_bytes;
+        collision_checks += stats.collision_checks;
+        culled += stats.culled_targets + stats.culled_fireballs;
+        triangles += stats.triangles;
+
+        if (csv) {
+            printf("%zu", frame);
+            for (int phase = 0; phase < PHASES_COUNT; ++phase) {
+                printf(",%lld", stats.phase_ns[phase]);
+            }
+            printf(",%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu\n", stats.ticks, stats.targets, stats.fireballs,
+                   stats.vertices, stats.instances, stats.upload_bytes, stats.collision_checks,
+                   stats.culled_targets, stats.culled_fireballs, stats.triangles);
+        }
+    }
+
+    if (csv || frames == 0) {
+        return 0;
+    }
+
+    const FrameStats& stats = simulation.stats();
+    printf("frames: %zu at %.0f fps, %zu ticks (%.1f s), seed: %u, %zu threads\n",
+           frames, fps, simulation.ticks(), simulation.time(), seed, simulation.threads());
+    printf("final state: %zu targets, %zu fireballs, %zu vertices, %zu instances, %zu frames with collisions\n",
+           stats.targets, stats.fireballs, stats.vertices, stats.instances, collisions);
+    printf("upload: %.1f KB/frame\n", upload_bytes / 1024.0 / frames);
+    printf("collision checks: %.1f/frame\n", (double)collision_checks / frames);
+    printf("culled: %.1f objects/frame\n", (double)culled / frames);
+    printf("drawn: %.1f triangles/frame\n", (double)triangles / frames);
+    printf("%-10s %14s %14s\n", "phase", "avg ns/frame", "max ns");
+    long long total = 0;
+    for (int phase = 0; phase < PHASES_COUNT; ++phase) {
+        printf("%-10s %14lld %14lld\n", PHASE_NAMES[phase], total_ns[phase] / (long long)frames, max_ns[phase]);
+        total += total_ns[phase];
+    }
+    printf("%-10s %14lld\n", "total", total / (long long)frames);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+struct Mesh;
+
+
+// Meshes of one model from the most to the least detailed. Level i + 1
+// takes over when the model covers less than sizes[i] of the screen height.
+// To keep a model near a boundary from flickering between two levels, it
+// only drops a level below (1 - HYSTERESIS) of the boundary and only gets
+// it back above (1 + HYSTERESIS) of it.
+struct LodChain {
+    static constexpr float HYSTERESIS = 0.2f;
+
+    std::vector<const Mesh*> meshes;
+    std::vector<float> sizes;
+
+    size_t levels() const {
+        return meshes.size();
+    }
+
+    // Level for a model that was drawn at level current and covers
+    // screen_size of the screen height now
+    size_t select(size_t current, float screen_size) const {
+        size_t level = current < levels() ? current : 0;
+        while (level + 1 < levels() && screen_size < sizes[level] * (1 - HYSTERESIS)) {
+            ++level;
+        }
+        while (level > 0 && screen_size > sizes[level - 1] * (1 + HYSTERESIS)) {
+            --level;
+        }
+        return level;
+    }
+};
@@ -1,11 +1,15 @@
 // Include standard headers
 #include <cstdio>
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 #include <random>
 #include <algorithm>
+#include <memory>
+#include <chrono>
 #include <iostream>  // for debugging
 
 // Include GLEW
@@ -20,8 +24,13 @@
 
 #include "controls.hpp"
 #include "objects.hpp"
-#include "common/texture.hpp"
-#include "common/shader.hpp"
+#include "simulation.hpp"
+#include "stream_buffer.hpp"
+#include "clock.hpp"
+#include "frustum.hpp"
+#include "pipeline.hpp"
+#include "common/texture_cache.hpp"
+#include "common/program_cache.hpp"
 
 
 GLFWwindow* initialize() {
@@ -70,79 +79,66 @@ GLFWwindow* initialize() {
     // Accept fragment if it closer to the camera than the former one
     glDepthFunc(GL_LESS);
 
-    // Cull triangles which normal is not towards the camera
-    //glEnable(GL_CULL_FACE);
+    // Cull triangles which normal is not towards the camera, every mesh is
+    // wound counterclockwise seen from outside (Mesh::orient)
+    glEnable(GL_CULL_FACE);
 
     return window;
 }
 
 
-bool is_too_far(const Object& object) {
-    return glm::distance(Controls::position, object.center) > 10.0f;
-}
-
-template <typename U, typename V>
-bool are_close(const U& lhs, const V& rhs) {
-    return glm::distance(lhs.center, rhs.center) < lhs.radius + rhs.radius;
-}
-
-
-std::default_random_engine generator;
-std::uniform_real_distribution<float> uniform(0.0, 1.0);
-
-void create_target(std::vector<Target>& targets, std::vector<glm::vec3>& speeds, int cur_ts) {
-    float x = uniform(generator) * 2 * 3.14;
-    float h = uniform(generator);
-    glm::vec3 center(5 * sin(x), 0.1 + 3 * h, 5 * cos(x));
-    GLfloat radius = 0.1f + 0.05 * uniform(generator);
-    glm::vec3 angle(
-            uniform(generator) * 3.14,
-            uniform(generator) * 3.14,
-            uniform(generator) * 3.14
-    );
-    std::vector<GLfloat> color({
-                                       uniform(generator),
-                                       uniform(generator),
-                                       uniform(generator)
-                               });
-    float brightness = std::accumulate(color.begin(), color.end(), 0.f);
-    targets.emplace_back(center + Controls::position * 0.5f, radius, angle, color,
-                         cur_ts + brightness * 1000);
-    speeds.emplace_back(
-            uniform(generator) / 100,
-            uniform(generator) / 100,
-            uniform(generator) / 100
-    );
-}
-
-template <typename T>
-void remove_object(std::vector<T>& objects, std::vector<glm::vec3>& speeds, int id=0) {
-    if (objects.size() > id) {
-        objects.erase(objects.begin() + id);
-        speeds.erase(speeds.begin() + id);
+// Picks the vertex upload path, --upload=persistent|orphan|reallocate overrides the default.
+StreamBuffer::Mode choose_upload_mode(int argc, char** argv) {
+    StreamBuffer::Mode mode = StreamBuffer::best_mode();
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--upload=orphan") == 0) {
+            mode = StreamBuffer::ORPHAN;
+        } else if (strcmp(argv[i], "--upload=reallocate") == 0) {
+            mode = StreamBuffer::REALLOCATE;
+        } else if (strcmp(argv[i], "--upload=persistent") == 0) {
+            if (StreamBuffer::best_mode() == StreamBuffer::PERSISTENT) {
+                mode = StreamBuffer::PERSISTENT;
+            } else {
+                fprintf(stderr, "Persistent mapping is not supported, falling back to orphaning\n");
+            }
+        }
     }
+    return mode;
 }
 
-
-void create_fireball(std::vector<Fireball>& fireballs, std::vector<glm::vec3>& speeds,
-                     const glm::vec3& direction) {
-    auto fireball = Fireball(0.5, 20);
-    fireball.move(Controls::position - glm::vec3(0, 1, 0));
-    fireballs.emplace_back(fireball);
-    speeds.emplace_back(direction * 0.5f);
+void print_upload_stats(const char* name, StreamBuffer& stream) {
+    const UploadStats& stats = stream.stats();
+    if (stats.frames > 0) {
+        printf("%s upload (%s): %.1f KB/frame, %.1f MB/s, %.1f us/frame stalled on fences\n",
+               name,
+               StreamBuffer::mode_name(stream.mode()),
+               stats.bytes / 1024.0 / stats.frames,
+               stats.megabytes_per_second(),
+               stats.stall_ns / 1e3 / stats.frames);
+    }
+    stream.reset_stats();
 }
 
 
-bool fireball_is_available(size_t iteration, size_t last_shoot_time) {
-    return (iteration - last_shoot_time > 20);
+// --uncapped turns vsync off, for measuring how fast frames can be made;
+// --serial simulates and draws on one thread; --raw-textures does not compress textures.
+bool has_flag(int argc, char** argv, const char* flag) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], flag) == 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
 
-int main() {
+int main(int argc, char** argv) {
     GLFWwindow* window = initialize();
+    glfwSwapInterval(has_flag(argc, argv, "--uncapped") ? 0 : 1);
 
     // Create and compile our GLSL program from the shaders
-    GLuint ProgramID = LoadShaders("/home/imroggen/OpenGL/ogl-master/GAME/TransformVertexShader.vertexshader", "/home/imroggen/OpenGL/ogl-master/GAME/ColorFragmentShader.fragmentshader" );
+    GLuint ProgramID = LoadShadersCached(resourcePath("TransformVertexShader.vertexshader").c_str(),
+                                         resourcePath("ColorFragmentShader.fragmentshader").c_str());
 
     // Get a handle for our "MVP" uniform
     GLuint MatrixID = glGetUniformLocation(ProgramID, "MVP");
@@ -153,93 +149,141 @@ int main() {
     GLuint vertexUVID = glGetAttribLocation(ProgramID, "vertexUV");
 
 
-    std::vector<Target> targets;
-    std::vector<glm::vec3> target_speeds;
-    std::vector<Fireball> fireballs;
-    std::vector<glm::vec3> fireball_speeds;
-
-    Buffer buffer;
-    Floor floor;
-
-    GLuint vertexbuffer;
-    glGenBuffers(1, &vertexbuffer);
-
-    GLuint colorbuffer;
-    glGenBuffers(1, &colorbuffer);
-
-    GLuint uvbuffer;
-    glGenBuffers(1, &uvbuffer);
+    // Cats are drawn from one shared mesh when the driver can instance,
+    // otherwise Target::draw bakes them into the vertex stream.
+    const bool instancing = GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced;
+
+    GLuint InstancedProgramID = 0;
+    GLuint InstancedMatrixID = 0;
+    GLuint instancePositionID = 0;
+    GLuint instanceModelID = 0;
+    GLuint instanceColorID = 0;
+    std::vector<GLuint> catbuffers;
+    std::vector<GLsizei> cat_vertices_counts;
+    if (instancing) {
+        InstancedProgramID = LoadShadersCached(resourcePath("InstancedVertexShader.vertexshader").c_str(),
+                                                resourcePath("ColorFragmentShader.fragmentshader").c_str());
+        InstancedMatrixID = glGetUniformLocation(InstancedProgramID, "MVP");
+        instancePositionID = glGetAttribLocation(InstancedProgramID, "vertexPosition_modelspace");
+        instanceModelID = glGetAttribLocation(InstancedProgramID, "instanceModel");
+        instanceColorID = glGetAttribLocation(InstancedProgramID, "instanceColor");
+
+        // Every level of the cat mesh is uploaded once
+        const LodChain& lods = cat_lods();
+        catbuffers.resize(lods.levels());
+        glGenBuffers(catbuffers.size(), catbuffers.data());
+        for (size_t level = 0; level < lods.levels(); ++level) {
+            const Mesh& mesh = *lods.meshes[level];
+            std::vector<glm::vec3> cat_vertices;
+            for (size_t i = 0; i < mesh.size(); ++i) {
+                cat_vertices.push_back(mesh.point(i));
+            }
+            cat_vertices_counts.push_back(cat_vertices.size());
+            glBindBuffer(GL_ARRAY_BUFFER, catbuffers[level]);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * cat_vertices.size(), cat_vertices.data(), GL_STATIC_DRAW);
+        }
+    }
+    printShaderCacheStats();
+
+    Simulation simulation(std::default_random_engine::default_seed, true);
+    Buffer buffer(instancing);
+
+    // The simulation runs in fixed ticks whatever the frame rate,
+    // frames are drawn between the last two ticks
+    FixedClock clock(Simulation::TICK);
+    double last_frame_time = glfwGetTime();
+
+    // By default the simulation makes frames on a thread of its own while this
+    // one, which owns the GL context and has to poll GLFW events, draws them;
+    // --serial does everything here, one step after the other.
+    std::unique_ptr<FramePipeline> pipeline;
+    if (!has_flag(argc, argv, "--serial")) {
+        pipeline.reset(new FramePipeline(simulation, instancing));
+    }
 
-    // Load the texture
-    GLuint Texture = loadBMP_custom("/home/imroggen/OpenGL/ogl-master/GAME/klubok.bmp");
+    // The interleaved vertices of a frame go to one streaming buffer,
+    // per-instance data to another
+    const StreamBuffer::Mode upload_mode = choose_upload_mode(argc, argv);
+    std::unique_ptr<StreamBuffer> stream(new StreamBuffer(upload_mode));
+    std::unique_ptr<StreamBuffer> instance_stream(new StreamBuffer(upload_mode, 1 << 16));
+    const size_t STATS_PERIOD = 600;
+    bool first_frame = true;
+    size_t frames_drawn = 0;
+    size_t frames_made = 0;
+    double view_latency_total = 0;
+    double latency_total = 0;
+
+    // Load the texture; it comes in from its own thread, the floor stays
+    // grey until it does. --raw-textures keeps it uncompressed.
+    TextureCache textures(GLEW_EXT_texture_compression_s3tc && !has_flag(argc, argv, "--raw-textures"));
+    GLuint Texture = textures.request(resourcePath("klubok.bmp"));
+    bool textures_ready = false;
 
     // Get a handle for our "myTextureSampler" uniform
     GLuint TextureID  = glGetUniformLocation(ProgramID, "myTextureSampler");
 
-    size_t iteration = 0;
-    size_t last_shoot_time = 0;
     do {
-        buffer.clear();
-
-        // create targets
-        if (uniform(generator) < 0.03) {
-            create_target(targets, target_speeds, iteration);
+        textures.poll();
+        if (!textures_ready && textures.pending() == 0) {
+            const TextureCacheStats& texture_stats = textures.stats();
+            printf("textures: %zu (%zu compressed, %.2f MB with mipmaps) ready %.1f ms after startup, "
+                   "%zu from the cache, %.2f ms to upload\n",
+                   texture_stats.textures, texture_stats.compressed, texture_stats.bytes / 1048576.0,
+                   glfwGetTime() * 1e3, texture_stats.from_cache, texture_stats.upload_ms);
+            textures_ready = true;
         }
 
-        // remove objects that are too far
-        for (size_t i = 0; i < targets.size(); ++i) {
-            if (targets[i].expired(iteration)) {
-                remove_object(targets, target_speeds, i);
+        // Get position from controls
+        Controls::computeMatricesFromInputs(window);
+        FrameInput input = {
+                {Controls::position, Controls::direction, Controls::isSpacePressed(window)},
+                true,
+                Controls::getProjectionMatrix(),
+                Controls::getViewMatrix(),
+                PipelineClock::now()
+        };
+
+        const Buffer* frame = &buffer;
+        const FrameStats* stats = &simulation.stats();
+        glm::mat4 ProjectionMatrix = input.projection;
+        glm::mat4 ViewMatrix = input.view;
+        PipelineClock::time_point input_time = input.time;
+        if (pipeline) {
+            pipeline->submit(input);
+            const Snapshot* snapshot = pipeline->latest();
+            if (snapshot == NULL) {
+                glfwPollEvents();
+                continue;
             }
-        }
-
-        bool has_collision = false;
-        // remove collided objects
-        for (size_t i = 0; i < targets.size(); ++i) {
-            for (size_t j = 0; j < fireballs.size(); ++j) {
-                if (are_close(targets[i], fireballs[j])) {
-                    std::cout << "COLLIDE" << std::endl;
-                    remove_object(targets, target_speeds, i);
-                    remove_object(fireballs, fireball_speeds, j);
-                    has_collision = true;
-                    break;
-                }
+            // The world is as of the input the snapshot was made from, but the
+            // camera is the one just read, so looking around does not lag behind.
+            // Something culled at the edge of the screen may show up a frame late
+            // on a quick turn.
+            frame = &snapshot->buffer;
+            stats = &snapshot->stats;
+            input_time = snapshot->input_time;
+        } else {
+            double now = glfwGetTime();
+            clock.advance(now - last_frame_time);
+            last_frame_time = now;
+            while (clock.tick()) {
+                simulation.tick(input.input);
             }
+            // Only what the camera sees goes to the GPU
+            simulation.emit(buffer, clock.alpha(), Frustum(ProjectionMatrix, ViewMatrix));
         }
-        if (has_collision) {
+        glm::mat4 ModelMatrix = glm::mat4(1.0);
+        glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
+
+        if (stats->has_collision) {
             glClearColor(1.0f, 1.0f, 0.2f, 0.0f);
         } else {
             glClearColor(0.0f, 0.7f, 1.0f, 0.0f);
         }
 
-
-        if (Controls::isSpacePressed(window) && fireball_is_available(iteration, last_shoot_time)) {
-            last_shoot_time = iteration;
-            std::cout << "Fire!\n";
-            create_fireball(fireballs, fireball_speeds, Controls::direction);
-        }
-
-        floor.draw(buffer);
-        for (size_t i = 0; i < targets.size(); ++i) {
-            targets[i].move(target_speeds[i]);
-            targets[i].draw(buffer);
-        }
-
-        for (size_t i = 0; i < fireballs.size(); ++i) {
-            fireballs[i].move(fireball_speeds[i]);
-            fireballs[i].draw(buffer);
-        }
-
         // Clear the screen
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Get position from controls
-        Controls::computeMatricesFromInputs(window);
-        glm::mat4 ProjectionMatrix = Controls::getProjectionMatrix();
-        glm::mat4 ViewMatrix = Controls::getViewMatrix();
-        glm::mat4 ModelMatrix = glm::mat4(1.0);
-        glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
-
         glUseProgram(ProgramID);
         // Send our transformation to the currently bound shader,
         // in the "MVP" uniform
@@ -250,42 +294,128 @@ int main() {
         glBindTexture(GL_TEXTURE_2D, Texture);
         glUniform1i(TextureID, 0);
 
-        // 1st attribute buffer : vertices
+        frame->write(stream->map(frame->byte_size()));
+        stream->unmap();
+        const size_t offset = stream->offset();
+
+        // Interleaved attributes : position, color, texture coordinates
         glEnableVertexAttribArray(vertexPosition_modelspaceID);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * buffer.size(), buffer.vertex_data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(vertexPosition_modelspaceID, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glVertexAttribPointer(vertexPosition_modelspaceID, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              (void*)(offset + offsetof(Vertex, position)));
 
-        // 2nd attribute buffer : colors
         glEnableVertexAttribArray(vertexColorID);
-        glBindBuffer(GL_ARRAY_BUFFER, colorbuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * buffer.size(), buffer.color_data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(vertexColorID, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glVertexAttribPointer(vertexColorID, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              (void*)(offset + offsetof(Vertex, color)));
 
-        // 3rd attribute buffer : textures
         glEnableVertexAttribArray(vertexUVID);
-        glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * buffer.texture_size(), buffer.texture_data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(vertexUVID, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glVertexAttribPointer(vertexUVID, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              (void*)(offset + offsetof(Vertex, uv)));
 
-        glDrawArrays(GL_TRIANGLES, 0, buffer.size() / 3);
+        glDrawArrays(GL_TRIANGLES, 0, frame->size());
+        stream->fence();
 
         glDisableVertexAttribArray(vertexPosition_modelspaceID);
         glDisableVertexAttribArray(vertexColorID);
         glDisableVertexAttribArray(vertexUVID);
+
+        if (frame->instance_count() > 0) {
+            frame->write_instances(instance_stream->map(frame->instance_byte_size()));
+            instance_stream->unmap();
+            const size_t instance_offset = instance_stream->offset();
+
+            glUseProgram(InstancedProgramID);
+            glUniformMatrix4fv(InstancedMatrixID, 1, GL_FALSE, &MVP[0][0]);
+
+            glEnableVertexAttribArray(instancePositionID);
+            for (GLuint column = 0; column < 4; ++column) {
+                glEnableVertexAttribArray(instanceModelID + column);
+                glVertexAttribDivisorARB(instanceModelID + column, 1);
+            }
+            glEnableVertexAttribArray(instanceColorID);
+            glVertexAttribDivisorARB(instanceColorID, 1);
+
+            // One draw per level of detail; the levels lie one after another in
+            // the instance stream, so each draw starts its instance attributes further on
+            size_t first_instance = 0;
+            for (size_t level = 0; level < frame->instance_levels(); ++level) {
+                const size_t count = frame->instance_count(level);
+                if (count == 0) {
+                    continue;
+                }
+                const size_t level_offset = instance_offset + sizeof(Instance) * first_instance;
+                first_instance += count;
+
+                glBindBuffer(GL_ARRAY_BUFFER, catbuffers[level]);
+                glVertexAttribPointer(instancePositionID, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+                // A mat4 attribute takes four consecutive locations, one per column
+                glBindBuffer(GL_ARRAY_BUFFER, instance_stream->buffer());
+                for (GLuint column = 0; column < 4; ++column) {
+                    glVertexAttribPointer(instanceModelID + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                                          (void*)(level_offset + offsetof(Instance, model) + sizeof(glm::vec4) * column));
+                }
+                glVertexAttribPointer(instanceColorID, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                                      (void*)(level_offset + offsetof(Instance, color)));
+
+                glDrawArraysInstancedARB(GL_TRIANGLES, 0, cat_vertices_counts[level], count);
+            }
+            instance_stream->fence();
+
+            // Divisors are not part of the program, reset them before the next plain draw
+            for (GLuint column = 0; column < 4; ++column) {
+                glVertexAttribDivisorARB(instanceModelID + column, 0);
+                glDisableVertexAttribArray(instanceModelID + column);
+            }
+            glVertexAttribDivisorARB(instanceColorID, 0);
+            glDisableVertexAttribArray(instanceColorID);
+            glDisableVertexAttribArray(instancePositionID);
+        }
+
         // Swap buffers
         glfwSwapBuffers(window);
         glfwPollEvents();
-        ++iteration;
+
+        if (first_frame) {
+            // GLFW counts time from glfwInit
+            printf("startup: %.1f ms to the first frame\n", glfwGetTime() * 1e3);
+            first_frame = false;
+        }
+        const PipelineClock::time_point swapped = PipelineClock::now();
+        view_latency_total += std::chrono::duration<double>(swapped - input.time).count();
+        latency_total += std::chrono::duration<double>(swapped - input_time).count();
+        ++frames_drawn;
+        if (frames_drawn == STATS_PERIOD) {
+            print_upload_stats("vertices", *stream);
+            print_upload_stats("instances", *instance_stream);
+            printf("culled: %zu of %zu targets, %zu of %zu fireballs, %zu triangles drawn\n",
+                   stats->culled_targets, stats->targets, stats->culled_fireballs, stats->fireballs, stats->triangles);
+            printf("%s: %.1f ms from input to swap for the camera, %.1f ms for the world",
+                   pipeline ? "pipelined" : "serial",
+                   view_latency_total * 1e3 / frames_drawn, latency_total * 1e3 / frames_drawn);
+            if (pipeline) {
+                printf(", %zu frames made for %zu drawn", pipeline->frames_made() - frames_made, frames_drawn);
+                frames_made = pipeline->frames_made();
+            }
+            printf("\n");
+            frames_drawn = 0;
+            view_latency_total = 0;
+            latency_total = 0;
+        }
 
     } // Check if the ESC key was pressed or the window was closed
     while(glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS
           && glfwWindowShouldClose(window) == 0);
 
+    // The simulation thread stops before anything else goes
+    pipeline.reset();
+
     // Cleanup VBO and shader
-    glDeleteBuffers(1, &vertexbuffer);
-    glDeleteBuffers(1, &colorbuffer);
-    glDeleteBuffers(1, &uvbuffer);
+    stream.reset();
+    instance_stream.reset();
+    if (instancing) {
+        glDeleteBuffers(catbuffers.size(), catbuffers.data());
+        glDeleteProgram(InstancedProgramID);
+    }
     glDeleteTextures(1, &Texture);
     glDeleteProgram(ProgramID);
 
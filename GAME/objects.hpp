@@ -1,394 +1,685 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <initializer_list>
+#include <map>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <cmath>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
 
 #include <GL/glew.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "transform_kernels.hpp"
+#include "lod.hpp"
+#include "cat.hpp"
+#include "common/obj_loader.hpp"
+#include "common/mesh_check.hpp"
+#include "common/mesh_optimize.hpp"
+#include "common/resource_path.hpp"
+
 class Triangle {
-    std::vector<glm::vec3> points;
+    std::array<glm::vec3, 3> points;
 
 public:
-    Triangle(const std::vector<GLfloat>& data) {
+    Triangle(std::initializer_list<GLfloat> data) {
         assert(data.size() == 9);
-        for (size_t i = 0; i < 3; ++i) {
-            auto iter = data.begin() + 3 * i;
-            points.emplace_back(
-                    glm::vec3(*iter, *(iter+1), *(iter+2))
-            );
+        auto iter = data.begin();
+        for (auto& point : points) {
+            point = glm::vec3(*iter, *(iter+1), *(iter+2));
+            iter += 3;
         }
     }
 
-    Triangle(const std::vector<glm::vec3>& points) : points(points) {
-        assert(points.size() == 3);
+    Triangle(const std::array<glm::vec3, 3>& points) : points(points) {}
+
+    const std::array<glm::vec3, 3>& get_points() const {
+        return points;
     }
+};
 
-    void move(const glm::vec3& shift) {
-        for (auto& point : points) {
-            point += shift;
+
+// Vertex positions stored as structure of arrays, so that a whole mesh
+// lives in three allocations and transforms run over contiguous floats.
+// Without indices every three consecutive vertices form a triangle.
+struct Mesh {
+    std::vector<GLfloat> x;
+    std::vector<GLfloat> y;
+    std::vector<GLfloat> z;
+    std::vector<glm::vec2> texcoords;
+    std::vector<GLushort> indices;
+
+    Mesh() {}
+
+    Mesh(std::initializer_list<Triangle> triangles) {
+        reserve(3 * triangles.size());
+        for (const auto& triangle : triangles) {
+            for (const auto& point : triangle.get_points()) {
+                add_vertex(point);
+            }
         }
     }
 
-    void stretch(GLfloat alpha) {
-        for (auto& point : points) {
-            point *= alpha;
+    void reserve(size_t vertices) {
+        x.reserve(vertices);
+        y.reserve(vertices);
+        z.reserve(vertices);
+    }
+
+    void add_vertex(const glm::vec3& point) {
+        x.push_back(point.x);
+        y.push_back(point.y);
+        z.push_back(point.z);
+    }
+
+    // Number of vertices
+    size_t size() const {
+        return x.size();
+    }
+
+    size_t triangles_count() const {
+        return (indices.empty() ? size() : indices.size()) / 3;
+    }
+
+    glm::vec3 point(size_t i) const {
+        return glm::vec3(x[i], y[i], z[i]);
+    }
+
+    // Radius of the smallest sphere around the origin holding every vertex
+    GLfloat bounding_radius() const {
+        GLfloat squared = 0;
+        for (size_t i = 0; i < size(); ++i) {
+            squared = std::max(squared, x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
         }
+        return std::sqrt(squared);
     }
 
-    void turn(const glm::vec3& angle) {
-        GLfloat sin1 = sin(angle.x);
-        GLfloat cos1 = cos(angle.x);
-        GLfloat sin2 = sin(angle.y);
-        GLfloat cos2 = cos(angle.y);
-        GLfloat sin3 = sin(angle.z);
-        GLfloat cos3 = cos(angle.z);
+    // Winds every triangle counterclockwise seen from outside, as back face
+    // culling needs (see common/mesh_check.hpp). A mesh that should be closed
+    // and is not gets reported on stderr under the given name.
+    MeshCheck orient(const char* name, bool closed=true) {
+        std::vector<float> corners;
+        corners.reserve(9 * triangles_count());
+        for (size_t i = 0; i < 3 * triangles_count(); ++i) {
+            size_t vertex = indices.empty() ? i : indices[i];
+            corners.insert(corners.end(), {x[vertex], y[vertex], z[vertex]});
+        }
+        std::vector<bool> flip;
+        MeshCheck check = checkMesh(corners.data(), triangles_count(), flip);
+        for (size_t t = 0; t < flip.size(); ++t) {
+            if (!flip[t]) {
+                continue;
+            }
+            if (!indices.empty()) {
+                std::swap(indices[3 * t + 1], indices[3 * t + 2]);
+                continue;
+            }
+            std::swap(x[3 * t + 1], x[3 * t + 2]);
+            std::swap(y[3 * t + 1], y[3 * t + 2]);
+            std::swap(z[3 * t + 1], z[3 * t + 2]);
+            if (!texcoords.empty()) {
+                std::swap(texcoords[3 * t + 1], texcoords[3 * t + 2]);
+            }
+        }
+        if (closed && !check.closed()) {
+            check.print(stderr, name);
+        }
+        return check;
+    }
 
-        for (auto& point : points) {
-            glm::vec3 new_point;
-            new_point.x = point.x * cos1 - point.y * sin1;
-            new_point.y = point.x * sin1 + point.y * cos1;
-            new_point.z = point.z;
-            point = new_point;
-            new_point.x = point.x * cos2 - point.z * sin2;
-            new_point.z = point.x * sin2 + point.z * cos2;
-            new_point.y = point.y;
-            point = new_point;
-            new_point.x = point.x * cos3 - point.y * sin3;
-            new_point.y = point.x * sin3 + point.y * cos3;
-            new_point.z = point.z;
-            point = new_point;
+    // Positions as three floats a vertex
+    std::vector<float> positions() const {
+        std::vector<float> result(3 * size());
+        for (size_t i = 0; i < size(); ++i) {
+            result[3 * i] = x[i];
+            result[3 * i + 1] = y[i];
+            result[3 * i + 2] = z[i];
         }
+        return result;
     }
 
-    const std::vector<glm::vec3>& get_points() const {
-        return points;
+    // Orders triangles for the vertex cache and to draw the outside first,
+    // then vertices in the order the triangles use them (see
+    // common/mesh_optimize.hpp). Without indices no vertex is shared and
+    // every triangle is placed on its own.
+    void optimize() {
+        const bool separate = indices.empty();
+        if (separate) {
+            assert(size() <= std::numeric_limits<GLushort>::max() + 1u);
+            indices.resize(size());
+            for (size_t i = 0; i < size(); ++i) {
+                indices[i] = i;
+            }
+        }
+        optimizeVertexCache(indices.data(), indices.size(), size());
+        optimizeOverdraw(indices.data(), indices.size(), positions().data(), size());
+        const std::vector<uint32_t> order = optimizeVertexFetch(indices.data(), indices.size(), size());
+
+        Mesh moved;
+        moved.reserve(size());
+        for (uint32_t i : order) {
+            moved.add_vertex(point(i));
+            if (!texcoords.empty()) {
+                moved.texcoords.push_back(texcoords[i]);
+            }
+        }
+        x.swap(moved.x);
+        y.swap(moved.y);
+        z.swap(moved.z);
+        texcoords.swap(moved.texcoords);
+        if (separate) {
+            indices.clear();
+        }
     }
 };
 
 
+// One vertex of the frame geometry, attributes are interleaved in a single stream.
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 color;
+    glm::vec2 uv;
+};
+
+static_assert(sizeof(Vertex) == 8 * sizeof(GLfloat), "Vertex must be tightly packed");
+
+
+// Per-instance data of a mesh that lives on the GPU and is drawn instanced.
+struct Instance {
+    glm::mat4 model;
+    glm::vec3 color;
+};
+
+static_assert(sizeof(Instance) == 19 * sizeof(GLfloat), "Instance must be tightly packed");
+
+
+// Vertices of a frame, plus instances of the shared cat mesh grouped by
+// level of detail: every level is drawn with its own instanced call.
 class Buffer {
-    std::vector<GLfloat> _vertex_data;
-    std::vector<GLfloat> _color_data;
-    std::vector<GLfloat> _texture_data;
+    std::vector<Vertex> _vertices;
+    std::vector<std::vector<Instance>> _instances;
+    bool _instancing;
 public:
-    Buffer() {}
+    explicit Buffer(bool instancing=true) : _instancing(instancing) {}
 
     void clear() {
-        _vertex_data.clear();
-        _color_data.clear();
+        _vertices.clear();
+        for (auto& level : _instances) {
+            level.clear();
+        }
     }
 
-    const void* vertex_data() {
-        return _vertex_data.data();
+    // Whether shared meshes should be emitted as instances or baked into vertices
+    bool instancing() const {
+        return _instancing;
     }
 
-    const void* color_data() {
-        return _color_data.data();
+    const Vertex* data() const {
+        return _vertices.data();
     }
 
-    const void* texture_data() {
-        return _texture_data.data();
+    // Number of vertices
+    size_t size() const {
+        return _vertices.size();
     }
 
-    size_t size() const {
-        assert(_vertex_data.size() == _color_data.size());
-        return _vertex_data.size();
+    size_t byte_size() const {
+        return sizeof(Vertex) * _vertices.size();
     }
 
-    size_t texture_size() const {
-        return _texture_data.size();
+    void write(char* destination) const {
+        std::memcpy(destination, _vertices.data(), byte_size());
     }
 
-    void add(const std::vector<Triangle>& triangles, const std::vector<GLfloat>& colors,
-        const std::vector<glm::vec2>& texcoords) {
-        assert(colors.size() == 3);
+    size_t instance_count() const {
+        size_t count = 0;
+        for (const auto& level : _instances) {
+            count += level.size();
+        }
+        return count;
+    }
 
-        for (auto& triangle: triangles) {
-            for (const auto& point : triangle.get_points()) {
-                _vertex_data.emplace_back(point.x);
-                _vertex_data.emplace_back(point.y);
-                _vertex_data.emplace_back(point.z);
-            }
+    size_t instance_levels() const {
+        return _instances.size();
+    }
 
-            for (int i = 0; i < 3; ++i) {
-                for (auto comp : colors) {
-                    _color_data.emplace_back(comp);
-                }
-            }
+    size_t instance_count(size_t level) const {
+        return level < _instances.size() ? _instances[level].size() : 0;
+    }
+
+    size_t instance_byte_size() const {
+        return sizeof(Instance) * instance_count();
+    }
+
+    // All levels one after another
+    void write_instances(char* destination) const {
+        for (const auto& level : _instances) {
+            std::memcpy(destination, level.data(), sizeof(Instance) * level.size());
+            destination += sizeof(Instance) * level.size();
         }
+    }
+
+    void add_instance(const Instance& instance, size_t level=0) {
+        *allocate_instances(1, level) = instance;
+    }
+
+    // Appends count vertices / instances for the caller to fill in, so that
+    // several threads can write disjoint parts of one allocation. The pointer
+    // is valid until the next allocation.
+    Vertex* allocate(size_t count) {
+        size_t first = _vertices.size();
+        _vertices.resize(first + count);
+        return _vertices.data() + first;
+    }
 
-        for (auto& coords: texcoords) {
-            _texture_data.emplace_back(coords.x);
-            _texture_data.emplace_back(coords.y);
+    Instance* allocate_instances(size_t count, size_t level=0) {
+        if (_instances.size() <= level) {
+            _instances.resize(level + 1);
+        }
+        size_t first = _instances[level].size();
+        _instances[level].resize(first + count);
+        return _instances[level].data() + first;
+    }
+
+    // Number of vertices fill writes for mesh
+    static size_t vertex_count(const Mesh& mesh) {
+        return mesh.indices.empty() ? mesh.size() : mesh.indices.size();
+    }
+
+    // Writes the triangles of mesh with vertex positions taken from x, y and z.
+    // Meshes without texture coordinates get (0, 0).
+    static void fill(Vertex* vertex, const Mesh& mesh, const GLfloat* x, const GLfloat* y, const GLfloat* z,
+                     const glm::vec3& color) {
+        const size_t count = vertex_count(mesh);
+        const bool textured = !mesh.texcoords.empty();
+
+        if (mesh.indices.empty()) {
+            for (size_t i = 0; i < count; ++i) {
+                vertex->position = glm::vec3(x[i], y[i], z[i]);
+                vertex->color = color;
+                vertex->uv = textured ? mesh.texcoords[i] : glm::vec2(0, 0);
+                ++vertex;
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t index = mesh.indices[i];
+            vertex->position = glm::vec3(x[index], y[index], z[index]);
+            vertex->color = color;
+            vertex->uv = textured ? mesh.texcoords[index] : glm::vec2(0, 0);
+            ++vertex;
         }
     }
 };
 
 
+// An object is a shared model-space mesh placed in the world by a transform.
+// Moving an object only changes the transform; world-space vertices are
+// baked when somebody asks for them and kept until the transform changes.
 class Object {
+    glm::vec3 position;
+    glm::mat3 linear;
+    GLfloat _extent;
+    mutable std::vector<GLfloat> world;
+    mutable bool dirty;
+
 protected:
-    std::vector<Triangle> triangles;
-    std::vector<GLfloat> colors;
-    std::vector<glm::vec2> texcoords;
+    const LodChain* lods;
+    size_t _level;
+    const Mesh* mesh;
+    glm::vec3 color;
+
+    Object(const Mesh* mesh, const glm::vec3& color)
+    : position(0, 0, 0), linear(1.0f), _extent(mesh->bounding_radius()), dirty(true),
+      lods(NULL), _level(0), mesh(mesh), color(color) {}
+
+    // Starts at the most detailed level of lods
+    Object(const LodChain* lods, const glm::vec3& color) : Object(lods->meshes[0], color) {
+        this->lods = lods;
+    }
+
+    // Rotation by Kernels::euler_rotation(angle) after scaling by alpha
+    void set_orientation(const glm::vec3& angle, GLfloat alpha) {
+        linear = Kernels::euler_rotation(angle) * alpha;
+        _extent = mesh->bounding_radius() * alpha;
+        dirty = true;
+    }
 
-    Object() : center(0, 0, 0) {}
 public:
-    glm::vec3 center;
-    void draw(Buffer& buffer) const {
-        buffer.add(triangles, colors, texcoords);
+    const glm::vec3& center() const {
+        return position;
+    }
+
+    // Radius of a sphere around center() holding the whole placed mesh
+    GLfloat extent() const {
+        return _extent;
     }
 
     void move(const glm::vec3& shift) {
-        center += shift;
-        for (auto& triangle : triangles) {
-            triangle.move(shift);
+        position += shift;
+        dirty = true;
+    }
+
+    void place(const glm::vec3& new_position) {
+        if (new_position != position) {
+            position = new_position;
+            dirty = true;
+        }
+    }
+
+    glm::mat4 model() const {
+        glm::mat4 result(linear);
+        result[3] = glm::vec4(position, 1.0f);
+        return result;
+    }
+
+    // World-space positions of the mesh vertices: all x, then all y, then all z.
+    const std::vector<GLfloat>& world_positions() const {
+        if (dirty) {
+            const size_t count = mesh->size();
+            world.resize(3 * count);
+            Kernels::kernels().transform(mesh->x.data(), mesh->y.data(), mesh->z.data(),
+                                         world.data(), world.data() + count, world.data() + 2 * count,
+                                         count, linear, position);
+            dirty = false;
+        }
+        return world;
+    }
+
+    size_t vertex_count() const {
+        return Buffer::vertex_count(*mesh);
+    }
+
+    // Levels of detail, or NULL if the object has only one mesh
+    const LodChain* lod_chain() const {
+        return lods;
+    }
+
+    size_t vertex_count(size_t level) const {
+        return lods ? Buffer::vertex_count(*lods->meshes[level]) : vertex_count();
+    }
+
+    size_t level() const {
+        return _level;
+    }
+
+    void set_level(size_t level) {
+        if (lods && level != _level) {
+            _level = level;
+            mesh = lods->meshes[level];
+            dirty = true;
         }
     }
+
+    // Writes vertex_count() vertices starting at out.
+    void emit(Vertex* out) const {
+        const size_t count = mesh->size();
+        const GLfloat* positions = world_positions().data();
+        Buffer::fill(out, *mesh, positions, positions + count, positions + 2 * count, color);
+    }
+
+    void draw(Buffer& buffer) const {
+        emit(buffer.allocate(vertex_count()));
+    }
 };
 
+
+// Only the top side, facing up: the camera never goes below the floor
+inline const Mesh& floor_mesh() {
+    static const GLfloat FIELD_SIZE = 10.0f;
+    static const Mesh mesh = []() {
+        Mesh mesh = {
+                Triangle({
+                        -FIELD_SIZE, 0.0f, -FIELD_SIZE,
+                        FIELD_SIZE, 0.0f,  FIELD_SIZE,
+                        FIELD_SIZE, 0.0f, -FIELD_SIZE,
+                }),
+                Triangle({
+                        FIELD_SIZE, 0.0f,  FIELD_SIZE,
+                        -FIELD_SIZE, 0.0f, -FIELD_SIZE,
+                        -FIELD_SIZE, 0.0f,  FIELD_SIZE,
+                }),
+        };
+        mesh.orient("floor", false);
+        return mesh;
+    }();
+    return mesh;
+}
+
 class Floor : public Object {
-    static constexpr GLfloat FIELD_SIZE = 10.0f;
 public:
-    Floor() {
-        auto t1 = Triangle({
-                   -FIELD_SIZE, 0.0f, -FIELD_SIZE,
-                   FIELD_SIZE, 0.0f,  FIELD_SIZE,
-                   FIELD_SIZE, 0.0f, -FIELD_SIZE,
-        });
-        auto t2 = Triangle({
-                   FIELD_SIZE, 0.0f,  FIELD_SIZE,
-                   -FIELD_SIZE, 0.0f, -FIELD_SIZE,
-                   -FIELD_SIZE, 0.0f,  FIELD_SIZE,
-        });
-        triangles = {t1, t2};
-        colors = {0.8, 0.7, 0.4};
-    }
+    Floor() : Object(&floor_mesh(), glm::vec3(0.8, 0.7, 0.4)) {}
 };
 
 
+// Sphere of `triangles_count / 2` rings with `triangles_count` quads each,
+// ring after ring.
+inline Mesh sphere_rings(GLfloat radius, size_t triangles_count) {
+    Mesh mesh;
+    const size_t squares_count = triangles_count / 2;
+    const size_t columns = triangles_count + 1;
+    mesh.reserve(columns * (squares_count + 1));
+    assert(columns * (squares_count + 1) <= std::numeric_limits<GLushort>::max());
+
+    // The poles and the seam are set exactly, so that the sphere is closed
+    std::vector<double> ring_sin(squares_count + 1), ring_cos(squares_count + 1);
+    for (size_t i = 0; i <= squares_count; ++i) {
+        double theta = (double)glm::pi<double>() * i / squares_count;
+        ring_sin[i] = i == squares_count ? 0.0 : sin(theta);
+        ring_cos[i] = i == squares_count ? -1.0 : cos(theta);
+    }
+    std::vector<double> column_sin(columns), column_cos(columns);
+    for (size_t j = 0; j < columns; ++j) {
+        double phi = 2.0f * glm::pi<double>() * (j % triangles_count) / triangles_count + glm::pi<double>();
+        column_sin[j] = sin(phi);
+        column_cos[j] = cos(phi);
+    }
+
+    // The first and last columns coincide but keep different texture coordinates
+    for (size_t i = 0; i <= squares_count; ++i) {
+        for (size_t j = 0; j < columns; ++j) {
+            mesh.add_vertex(glm::vec3(
+                    column_cos[j] * ring_sin[i] * radius,
+                    column_sin[j] * ring_sin[i] * radius,
+                    ring_cos[i] * radius
+            ));
+            mesh.texcoords.emplace_back((float)j / triangles_count, 1.0f - (float)i / squares_count);
+        }
+    }
+
+    for (size_t i = 0; i < squares_count; ++i) {
+        for (size_t j = 0; j < triangles_count; ++j) {
+            GLushort top = i * columns + j;
+            GLushort bottom = (i + 1) * columns + j;
+            // Around the poles one of the two triangles is only a line
+            if (i > 0) {
+                mesh.indices.insert(mesh.indices.end(), {top, (GLushort)(bottom + 1), (GLushort)(top + 1)});
+            }
+            if (i + 1 < squares_count) {
+                mesh.indices.insert(mesh.indices.end(), {top, bottom, (GLushort)(bottom + 1)});
+            }
+        }
+    }
+    mesh.orient("sphere");
+    return mesh;
+}
+
+// sphere_rings reordered for drawing. Meshes are built once per
+// (radius, triangles_count) and shared by all fireballs.
+inline const Mesh& sphere_mesh(GLfloat radius, size_t triangles_count) {
+    static std::map<std::pair<GLfloat, size_t>, Mesh> cache;
+
+    auto found = cache.find(std::make_pair(radius, triangles_count));
+    if (found != cache.end()) {
+        return found->second;
+    }
+    Mesh& mesh = cache[std::make_pair(radius, triangles_count)];
+    mesh = sphere_rings(radius, triangles_count);
+    mesh.optimize();
+    return mesh;
+}
+
+
+// Spheres with triangles_count, half and a quarter of it, for fireballs
+// covering more than 12%, 5% and less of the screen height.
+inline const LodChain& sphere_lods(GLfloat radius, size_t triangles_count) {
+    static std::map<std::pair<GLfloat, size_t>, LodChain> cache;
+
+    LodChain& lods = cache[std::make_pair(radius, triangles_count)];
+    if (lods.meshes.empty()) {
+        for (size_t count : {triangles_count, triangles_count / 2, triangles_count / 4}) {
+            lods.meshes.push_back(&sphere_mesh(radius, std::max<size_t>(count, 4)));
+        }
+        lods.sizes = {0.12f, 0.05f};
+    }
+    return lods;
+}
+
+
 class Fireball : public Object {
 public:
-    GLfloat radius;
-
-    Fireball(GLfloat radius, size_t triangles_count, const std::vector<GLfloat>& colors={0.0, 0.0, 0.0})
-    : radius(radius) {
-        this->colors = colors;
-        const size_t squares_count = triangles_count / 2;
-        for (size_t i = 0; i < squares_count; ++i) {
-            double theta = (double)glm::pi<double>() * i / squares_count;
-            double theta1 = (double)glm::pi<double>() * (i + 1) / squares_count;
-
-            for (size_t j = 0; j < triangles_count; ++j) {
-                double phi = 2.0f * glm::pi<double>() * j / triangles_count + glm::pi<double>();
-                double phi1 = 2.0f * glm::pi<double>() * (j + 1) / triangles_count + glm::pi<double>();
-
-                //Первый треугольник
-                triangles.emplace_back(Triangle(std::vector<glm::vec3>{
-                    glm::vec3(
-                        cos(phi) * sin(theta) * radius,
-                        sin(phi) * sin(theta) * radius,
-                        cos(theta) * radius
-                    ),
-                    glm::vec3(
-                        cos(phi1) * sin(theta1) * radius,
-                        sin(phi1) * sin(theta1) * radius,
-                        cos(theta1) * radius
-                    ),
-                    glm::vec3(
-                        cos(phi1) * sin(theta) * radius,
-                        sin(phi1) * sin(theta) * radius,
-                        cos(theta) * radius
-                    )
-                }));
-
-                texcoords.emplace_back(glm::vec2((float)j / triangles_count, 1.0 - (float)i / squares_count));
-                texcoords.emplace_back(glm::vec2((float)(j + 1) / triangles_count, 1.0 - (float)(i + 1) / squares_count));
-                texcoords.emplace_back(glm::vec2((float)(j + 1) / triangles_count, 1.0 - (float)i / squares_count));
-
-
-                //Второй треугольник
-                triangles.emplace_back(Triangle(std::vector<glm::vec3>{
-                    glm::vec3(
-                        cos(phi) * sin(theta) * radius,
-                        sin(phi) * sin(theta) * radius,
-                        cos(theta) * radius
-                    ),
-                    glm::vec3(
-                        cos(phi) * sin(theta1) * radius,
-                        sin(phi) * sin(theta1) * radius,
-                        cos(theta1) * radius
-                    ),
-                    glm::vec3(
-                        cos(phi1) * sin(theta1) * radius,
-                        sin(phi1) * sin(theta1) * radius,
-                        cos(theta1) * radius
-                    )
-                }));
-
-                texcoords.emplace_back(glm::vec2((float)j / triangles_count, 1.0f - (float)i / squares_count));
-                texcoords.emplace_back(glm::vec2((float)j / triangles_count, 1.0f - (float)(i + 1) / squares_count));
-                texcoords.emplace_back(glm::vec2((float)(j + 1) / triangles_count, 1.0f - (float)(i + 1) / squares_count));
+    Fireball(GLfloat radius, size_t triangles_count, const glm::vec3& color=glm::vec3(0.0, 0.0, 0.0))
+    : Object(&sphere_lods(radius, triangles_count), color) {}
+};
+
+// An indexed mesh from an OBJ file, for models made in an editor; normals
+// are dropped since nothing is lit. Mesh indices are 16 bits, so a model
+// with more than 65535 vertices is refused like one that fails to load:
+// false is returned, the reason is on stderr and mesh is left alone.
+inline bool load_obj(const std::string& name, Mesh& mesh) {
+    const std::string path = resourcePath(name);
+    ObjMesh obj;
+    if (!loadOBJ(path.c_str(), obj)) {
+        fprintf(stderr, "Failed to load model %s\n", path.c_str());
+        return false;
+    }
+    if (obj.vertexCount() > std::numeric_limits<GLushort>::max()) {
+        fprintf(stderr, "Model %s has %zu vertices, at most %u fit 16-bit indices\n", path.c_str(),
+                obj.vertexCount(), unsigned(std::numeric_limits<GLushort>::max()));
+        return false;
+    }
+    Mesh loaded;
+    loaded.reserve(obj.vertexCount());
+    for (size_t i = 0; i < obj.vertexCount(); ++i) {
+        loaded.add_vertex(glm::vec3(obj.positions[3 * i], obj.positions[3 * i + 1], obj.positions[3 * i + 2]));
+        if (!obj.texcoords.empty()) {
+            loaded.texcoords.emplace_back(obj.texcoords[2 * i], obj.texcoords[2 * i + 1]);
+        }
+    }
+    loaded.indices.assign(obj.indices.begin(), obj.indices.end());
+    mesh = std::move(loaded);
+    return true;
+}
+
+// The compile-time cat (see cat.hpp), made on first use and ordered to
+// draw its outside first. Its pieces overlap, so each is checked on its own.
+inline const Mesh& cat_mesh() {
+    static const Mesh mesh = []() {
+        Mesh mesh;
+        for (size_t piece = 0; piece < cat::TRIANGLES.piece_count; ++piece) {
+            Mesh own;
+            for (size_t i = 0; i < cat::VERTICES; ++i) {
+                if (cat::TRIANGLES.pieces[i / 3] == piece) {
+                    own.add_vertex(glm::vec3(cat::TRIANGLES.x[i], cat::TRIANGLES.y[i], cat::TRIANGLES.z[i]));
+                }
             }
+            own.orient("cat");
+            mesh.x.insert(mesh.x.end(), own.x.begin(), own.x.end());
+            mesh.y.insert(mesh.y.end(), own.y.begin(), own.y.end());
+            mesh.z.insert(mesh.z.end(), own.z.begin(), own.z.end());
         }
+        mesh.optimize();
+        return mesh;
+    }();
+    return mesh;
+}
+
+
+// Vertex clustering: vertices are snapped to the average of all vertices
+// in the same cube of the grid with the given cell size, and triangles that
+// collapse or repeat another one are dropped. Parts squeezed together meet
+// at edges of more than two triangles, so the result is seldom closed.
+inline Mesh simplified(const Mesh& mesh, GLfloat cell) {
+    assert(mesh.indices.empty());
+    std::map<std::array<int, 3>, std::pair<glm::vec3, size_t>> clusters;
+    std::vector<std::array<int, 3>> keys(mesh.size());
+    for (size_t i = 0; i < mesh.size(); ++i) {
+        glm::vec3 point = mesh.point(i);
+        keys[i] = {{(int)std::floor(point.x / cell), (int)std::floor(point.y / cell), (int)std::floor(point.z / cell)}};
+        auto& cluster = clusters[keys[i]];
+        cluster.first += point;
+        ++cluster.second;
     }
-};
 
-const std::vector<Triangle> CAT_TRIANGLES = {
-        Triangle({0.0f,0.0f,0.0f, 0.0f,3.0f,3.0f, 0.0f,0.0f,3.0f, }),
-        Triangle({0.0f,0.0f,0.0f, 0.0f,3.0f,0.0f, 0.0f,3.0f,3.0f, }),
-        Triangle({0.0f,0.0f,0.0f, 8.0f,0.0f,3.0f, 8.0f,0.0f,0.0f,}),
-        Triangle({0.0f,0.0f,0.0f, 0.0f,0.0f,3.0f, 8.0f,0.0f,3.0f,}),
-        Triangle({0.0f,0.0f,0.0f, 8.0f,3.0f,0.0f, 0.0f,3.0f,0.0f,}),
-        Triangle({0.0f,0.0f,0.0f, 8.0f,0.0f,0.0f, 8.0f,3.0f,0.0f,}),
-        Triangle({0.0f,0.0f,3.0f, 0.0f,3.0f,3.0f, 8.0f,3.0f,3.0f, }),
-        Triangle({0.0f,0.0f,3.0f, 8.0f,3.0f,3.0f, 8.0f,0.0f,3.0f,}),
-        Triangle({0.0f,3.0f,0.0f, 8.0f,3.0f,3.0f, 8.0f,3.0f,0.0f,}),
-        Triangle({0.0f,3.0f,0.0f, 0.0f,3.0f,3.0f, 8.0f,3.0f,3.0f, }),
-        Triangle({8.0f,0.0f,0.0f, 8.0f,3.0f,3.0f, 8.0f,0.0f,3.0f, }),
-        Triangle({8.0f,0.0f,0.0f, 8.0f,3.0f,0.0f, 8.0f,3.0f,3.0f, }),
-//
-        Triangle({7.0f,0.0f,3.0f, 7.0f,3.0f,6.0f, 7.0f,0.0f,6.0f,}),
-        Triangle({7.0f,0.0f,3.0f, 7.0f,3.0f,6.0f, 7.0f,3.0f,3.0f,}),
-        Triangle({7.0f,0.0f,3.0f, 11.0f,0.0f,6.0f, 11.0f,0.0f,3.0f,}),
-        Triangle({7.0f,0.0f,3.0f, 11.0f,0.0f,6.0f, 7.0f,0.0f,6.0f,}),
-        Triangle({7.0f,0.0f,3.0f, 11.0f,3.0f,3.0f, 7.0f,3.0f,3.0f,}),
-        Triangle({7.0f,0.0f,3.0f, 11.0f,3.0f,3.0f, 11.0f,0.0f,3.0f,}),
-        Triangle({7.0f,0.0f,6.0f, 11.0f,3.0f,6.0f, 7.0f,3.0f,6.0f,}),
-        Triangle({7.0f,0.0f,6.0f, 11.0f,3.0f,6.0f, 11.0f,0.0f,6.0f,}),
-        Triangle({7.0f,3.0f,3.0f, 11.0f,3.0f,6.0f, 11.0f,3.0f,3.0f,}),
-        Triangle({7.0f,3.0f,3.0f, 11.0f,3.0f,6.0f, 7.0f,3.0f,6.0f,}),
-        Triangle({11.0f,0.0f,3.0f, 11.0f,3.0f,6.0f, 11.0f,0.0f,6.0f,}),
-        Triangle({11.0f,0.0f,3.0f, 11.0f,3.0f,6.0f, 11.0f,3.0f,3.0f,}),
-
-        Triangle({8.0f,0.0f,6.0f, 7.0f,1.0f,6.0f, 7.0f,0.0f,7.0f,}),
-        Triangle({7.0f,0.0f,6.0f, 7.0f,0.0f,7.0f, 7.0f,1.0f,6.0f, }),
-        Triangle({7.0f,0.0f,6.0f, 8.0f,0.0f,6.0f, 7.0f,0.0f,7.0f,}),
-        Triangle({7.0f,0.0f,6.0f, 8.0f,0.0f,6.0f, 7.0f,1.0f,6.0f,}),
-
-        Triangle({8.0f,3.0f,6.0f, 7.0f,2.0f,6.0f, 7.0f,3.0f,7.0f,}),
-        Triangle({7.0f,3.0f,6.0f, 7.0f,2.0f,6.0f, 7.0f,3.0f,7.0f,}),
-        Triangle({7.0f,3.0f,6.0f, 8.0f,3.0f,6.0f, 7.0f,3.0f,7.0f,}),
-        Triangle({7.0f,3.0f,6.0f, 8.0f,3.0f,6.0f, 7.0f,2.0f,6.0f,}),
-//
-        Triangle({-3.0f,1.0f,2.0f, -3.0f,2.0f,3.0f, -3.0f,1.0f,3.0f,}),
-        Triangle({-3.0f,1.0f,2.0f, -3.0f,2.0f,3.0f, -3.0f,2.0f,2.0f,}),
-        Triangle({-3.0f,1.0f,2.0f, 0.0f,1.0f,3.0f, 0.0f,1.0f,2.0f,}),
-        Triangle({-3.0f,1.0f,2.0f, 0.0f,1.0f,3.0f, -3.0f,1.0f,3.0f,}),
-        Triangle({-3.0f,1.0f,2.0f, 0.0f,2.0f,2.0f, -3.0f,2.0f,2.0f,}),
-        Triangle({-3.0f,1.0f,2.0f, 0.0f,2.0f,2.0f, 0.0f,1.0f,2.0f,}),
-        Triangle({-3.0f,1.0f,3.0f, 0.0f,2.0f,3.0f, -3.0f,2.0f,3.0f,}),
-        Triangle({-3.0f,1.0f,3.0f, 0.0f,2.0f,3.0f, 0.0f,1.0f,3.0f,}),
-        Triangle({-3.0f,2.0f,2.0f, 0.0f,2.0f,3.0f, 0.0f,2.0f,2.0f,}),
-        Triangle({-3.0f,2.0f,2.0f, 0.0f,2.0f,3.0f, -3.0f,2.0f,3.0f,}),
-        Triangle({0.0f,1.0f,2.0f, 0.0f,2.0f,3.0f, 0.0f,1.0f,3.0f,}),
-        Triangle({0.0f,1.0f,2.0f, 0.0f,2.0f,3.0f, 0.0f,2.0f,2.0f,}),
-//
-        Triangle({-3.0f,1.0f,3.0f, -3.0f,2.0f,5.0f, -3.0f,1.0f,5.0f,}),
-        Triangle({-3.0f,1.0f,3.0f, -3.0f,2.0f,5.0f, -3.0f,2.0f,3.0f,}),
-        Triangle({-3.0f,1.0f,3.0f, -2.0f,1.0f,5.0f, -2.0f,1.0f,3.0f,}),
-        Triangle({-3.0f,1.0f,3.0f, -2.0f,1.0f,5.0f, -3.0f,1.0f,5.0f,}),
-        Triangle({-3.0f,1.0f,3.0f, -2.0f,2.0f,3.0f, -3.0f,2.0f,3.0f,}),
-        Triangle({-3.0f,1.0f,3.0f, -2.0f,2.0f,3.0f, -2.0f,1.0f,3.0f,}),
-        Triangle({-3.0f,1.0f,5.0f, -2.0f,2.0f,5.0f, -3.0f,2.0f,5.0f,}),
-        Triangle({-3.0f,1.0f,5.0f, -2.0f,2.0f,5.0f, -2.0f,1.0f,5.0f,}),
-        Triangle({-3.0f,2.0f,3.0f, -2.0f,2.0f,5.0f, -2.0f,2.0f,3.0f,}),
-        Triangle({-3.0f,2.0f,3.0f, -2.0f,2.0f,5.0f, -3.0f,2.0f,5.0f,}),
-        Triangle({-2.0f,1.0f,3.0f, -2.0f,2.0f,5.0f, -2.0f,1.0f,5.0f,}),
-        Triangle({-2.0f,1.0f,3.0f, -2.0f,2.0f,5.0f, -2.0f,2.0f,3.0f,}),
-//
-        Triangle({-4.0f,1.0f,4.0f, -4.0f,2.0f,5.0f, -4.0f,1.0f,5.0f,}),
-        Triangle({-4.0f,1.0f,4.0f, -4.0f,2.0f,5.0f, -4.0f,2.0f,4.0f,}),
-        Triangle({-4.0f,1.0f,4.0f, -3.0f,1.0f,5.0f, -3.0f,1.0f,4.0f,}),
-        Triangle({-4.0f,1.0f,4.0f, -3.0f,1.0f,5.0f, -4.0f,1.0f,5.0f,}),
-        Triangle({-4.0f,1.0f,4.0f, -3.0f,2.0f,4.0f, -4.0f,2.0f,4.0f,}),
-        Triangle({-4.0f,1.0f,4.0f, -3.0f,2.0f,4.0f, -3.0f,1.0f,4.0f,}),
-        Triangle({-4.0f,1.0f,5.0f, -3.0f,2.0f,5.0f, -4.0f,2.0f,5.0f,}),
-        Triangle({-4.0f,1.0f,5.0f, -3.0f,2.0f,5.0f, -3.0f,1.0f,5.0f,}),
-        Triangle({-4.0f,2.0f,4.0f, -3.0f,2.0f,5.0f, -3.0f,2.0f,4.0f,}),
-        Triangle({-4.0f,2.0f,4.0f, -3.0f,2.0f,5.0f, -4.0f,2.0f,5.0f,}),
-        Triangle({-3.0f,1.0f,4.0f, -3.0f,2.0f,5.0f, -3.0f,1.0f,5.0f,}),
-        Triangle({-3.0f,1.0f,4.0f, -3.0f,2.0f,5.0f, -3.0f,2.0f,4.0f,}),
-//
-        Triangle({7.0f,0.0f,-1.0f, 7.0f,1.0f,0.0f, 7.0f,0.0f,0.0f,}),
-        Triangle({7.0f,0.0f,-1.0f, 7.0f,1.0f,0.0f, 7.0f,1.0f,-1.0f,}),
-        Triangle({7.0f,0.0f,-1.0f, 8.0f,0.0f,0.0f, 8.0f,0.0f,-1.0f,}),
-        Triangle({7.0f,0.0f,-1.0f, 8.0f,0.0f,0.0f, 7.0f,0.0f,0.0f,}),
-        Triangle({7.0f,0.0f,-1.0f, 8.0f,1.0f,-1.0f, 7.0f,1.0f,-1.0f,}),
-        Triangle({7.0f,0.0f,-1.0f, 8.0f,1.0f,-1.0f, 8.0f,0.0f,-1.0f,}),
-        Triangle({7.0f,0.0f,0.0f, 8.0f,1.0f,0.0f, 7.0f,1.0f,0.0f,}),
-        Triangle({7.0f,0.0f,0.0f, 8.0f,1.0f,0.0f, 8.0f,0.0f,0.0f,}),
-        Triangle({7.0f,1.0f,-1.0f, 8.0f,1.0f,0.0f, 8.0f,1.0f,-1.0f,}),
-        Triangle({7.0f,1.0f,-1.0f, 8.0f,1.0f,0.0f, 7.0f,1.0f,0.0f,}),
-        Triangle({8.0f,0.0f,-1.0f, 8.0f,1.0f,0.0f, 8.0f,0.0f,0.0f,}),
-        Triangle({8.0f,0.0f,-1.0f, 8.0f,1.0f,0.0f, 8.0f,1.0f,-1.0f,}),
-//
-        Triangle({7.0f,2.0f,-1.0f, 7.0f,3.0f,0.0f, 7.0f,2.0f,0.0f,}),
-        Triangle({7.0f,2.0f,-1.0f, 7.0f,3.0f,0.0f, 7.0f,3.0f,-1.0f,}),
-        Triangle({7.0f,2.0f,-1.0f, 8.0f,2.0f,0.0f, 8.0f,2.0f,-1.0f,}),
-        Triangle({7.0f,2.0f,-1.0f, 8.0f,2.0f,0.0f, 7.0f,2.0f,0.0f,}),
-        Triangle({7.0f,2.0f,-1.0f, 8.0f,3.0f,-1.0f, 7.0f,3.0f,-1.0f,}),
-        Triangle({7.0f,2.0f,-1.0f, 8.0f,3.0f,-1.0f, 8.0f,2.0f,-1.0f,}),
-        Triangle({7.0f,2.0f,0.0f, 8.0f,3.0f,0.0f, 7.0f,3.0f,0.0f,}),
-        Triangle({7.0f,2.0f,0.0f, 8.0f,3.0f,0.0f, 8.0f,2.0f,0.0f,}),
-        Triangle({7.0f,3.0f,-1.0f, 8.0f,3.0f,0.0f, 8.0f,3.0f,-1.0f,}),
-        Triangle({7.0f,3.0f,-1.0f, 8.0f,3.0f,0.0f, 7.0f,3.0f,0.0f,}),
-        Triangle({8.0f,2.0f,-1.0f, 8.0f,3.0f,0.0f, 8.0f,2.0f,0.0f,}),
-        Triangle({8.0f,2.0f,-1.0f, 8.0f,3.0f,0.0f, 8.0f,3.0f,-1.0f,}),
-//
-        Triangle({0.0f,2.0f,-1.0f, 0.0f,3.0f,0.0f, 0.0f,2.0f,0.0f,}),
-        Triangle({0.0f,2.0f,-1.0f, 0.0f,3.0f,0.0f, 0.0f,3.0f,-1.0f,}),
-        Triangle({0.0f,2.0f,-1.0f, 1.0f,2.0f,0.0f, 1.0f,2.0f,-1.0f,}),
-        Triangle({0.0f,2.0f,-1.0f, 1.0f,2.0f,0.0f, 0.0f,2.0f,0.0f,}),
-        Triangle({0.0f,2.0f,-1.0f, 1.0f,3.0f,-1.0f, 0.0f,3.0f,-1.0f,}),
-        Triangle({0.0f,2.0f,-1.0f, 1.0f,3.0f,-1.0f, 1.0f,2.0f,-1.0f,}),
-        Triangle({0.0f,2.0f,0.0f, 1.0f,3.0f,0.0f, 0.0f,3.0f,0.0f,}),
-        Triangle({0.0f,2.0f,0.0f, 1.0f,3.0f,0.0f, 1.0f,2.0f,0.0f,}),
-        Triangle({0.0f,3.0f,-1.0f, 1.0f,3.0f,0.0f, 1.0f,3.0f,-1.0f,}),
-        Triangle({0.0f,3.0f,-1.0f, 1.0f,3.0f,0.0f, 0.0f,3.0f,0.0f,}),
-        Triangle({1.0f,2.0f,-1.0f, 1.0f,3.0f,0.0f, 1.0f,2.0f,0.0f,}),
-        Triangle({1.0f,2.0f,-1.0f, 1.0f,3.0f,0.0f, 1.0f,3.0f,-1.0f,}),
-//
-        Triangle({0.0f,0.0f,-1.0f, 0.0f,1.0f,0.0f, 0.0f,0.0f,0.0f,}),
-        Triangle({0.0f,0.0f,-1.0f, 0.0f,1.0f,0.0f, 0.0f,1.0f,-1.0f,}),
-        Triangle({0.0f,0.0f,-1.0f, 1.0f,0.0f,0.0f, 1.0f,0.0f,-1.0f,}),
-        Triangle({0.0f,0.0f,-1.0f, 1.0f,0.0f,0.0f, 0.0f,0.0f,0.0f,}),
-        Triangle({0.0f,0.0f,-1.0f, 1.0f,1.0f,-1.0f, 0.0f,1.0f,-1.0f,}),
-        Triangle({0.0f,0.0f,-1.0f, 1.0f,1.0f,-1.0f, 1.0f,0.0f,-1.0f,}),
-        Triangle({0.0f,0.0f,0.0f, 1.0f,1.0f,0.0f, 0.0f,1.0f,0.0f,}),
-        Triangle({0.0f,0.0f,0.0f, 1.0f,1.0f,0.0f, 1.0f,0.0f,0.0f,}),
-        Triangle({0.0f,1.0f,-1.0f, 1.0f,1.0f,0.0f, 1.0f,1.0f,-1.0f,}),
-        Triangle({0.0f,1.0f,-1.0f, 1.0f,1.0f,0.0f, 0.0f,1.0f,0.0f,}),
-        Triangle({1.0f,0.0f,-1.0f, 1.0f,1.0f,0.0f, 1.0f,0.0f,0.0f,}),
-        Triangle({1.0f,0.0f,-1.0f, 1.0f,1.0f,0.0f, 1.0f,1.0f,-1.0f,}),
-};
+    Mesh result;
+    std::map<std::array<std::array<int, 3>, 3>, bool> seen;
+    for (size_t i = 0; i + 2 < mesh.size(); i += 3) {
+        std::array<std::array<int, 3>, 3> triangle = {{keys[i], keys[i + 1], keys[i + 2]}};
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+            continue;
+        }
+        // The same corners wound the other way are the back of a part that
+        // got flattened, and are kept so it shows from both sides
+        std::array<std::array<int, 3>, 3> turned = triangle;
+        std::rotate(turned.begin(), std::min_element(turned.begin(), turned.end()), turned.end());
+        if (seen[turned]) {
+            continue;
+        }
+        seen[turned] = true;
+        for (const auto& key : triangle) {
+            const auto& cluster = clusters[key];
+            result.add_vertex(cluster.first * (1.0f / cluster.second));
+        }
+    }
+    result.orient("simplified mesh", false);
+    result.optimize();
+    return result;
+}
 
+// The full cat and a clustered one for cats under 10% of the screen height
+inline const LodChain& cat_lods() {
+    static const Mesh far_cat = simplified(cat_mesh(), 3.0f);
+    static const LodChain lods = {{&cat_mesh(), &far_cat}, {0.1f}};
+    return lods;
+}
 
+
+// Cats share the meshes of cat_lods(), a target only keeps its own placement and color.
 class Target : public Object {
-    int lifetime;
 public:
-    GLfloat radius;
-
     Target(const glm::vec3& icenter,
             GLfloat radius,
             const glm::vec3& angle,
-            const std::vector<GLfloat>& icolor,
-            int lifetime
-            ) : lifetime(lifetime), radius(radius) {
-        triangles = std::vector<Triangle>(CAT_TRIANGLES);
-        colors = icolor;
-        center = icenter;
-        for (auto& t : triangles) {
-            t.stretch(radius);
-            t.turn(angle);
-            t.move(icenter);
-        }
+            const std::vector<GLfloat>& icolor
+            ) : Object(&cat_lods(), glm::vec3(icolor[0], icolor[1], icolor[2])) {
+        // Scaled by radius, then turned by angle
+        set_orientation(angle, radius);
+        move(icenter);
+    }
+
+    Instance instance() const {
+        Instance result;
+        result.model = model();
+        result.color = color;
+        return result;
     }
-    bool expired(int timestamp) const {
-        return timestamp >= lifetime;
+
+    void draw(Buffer& buffer) const {
+        if (buffer.instancing()) {
+            buffer.add_instance(instance(), level());
+        } else {
+            Object::draw(buffer);
+        }
     }
 };
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include "objects.hpp"
+#include "simulation.hpp"
+#include "clock.hpp"
+#include "frustum.hpp"
+#include "triple_buffer.hpp"
+
+
+typedef std::chrono::steady_clock PipelineClock;
+
+// What the render thread read from the player for one frame
+struct FrameInput {
+    Input input;
+    bool has_camera;
+    glm::mat4 projection;
+    glm::mat4 view;
+    PipelineClock::time_point time;  // when the input was read
+};
+
+// Everything needed to draw one frame. The simulation thread fills it and
+// does not touch it again until the render thread has moved on to a newer one.
+struct Snapshot {
+    Buffer buffer;
+    FrameStats stats;
+    glm::mat4 projection;
+    glm::mat4 view;
+    PipelineClock::time_point input_time;  // of the input the frame was made from
+    size_t sequence;
+
+    explicit Snapshot(bool instancing=true) : buffer(instancing), stats(), sequence(0) {}
+};
+
+
+// Runs the simulation and vertex generation on a thread of their own, so the
+// render thread only uploads and draws. Input goes one way and finished frames
+// the other, both through triple buffers: neither thread ever waits for the
+// other, and each always sees the newest the other has made.
+// The simulation belongs to the pipeline thread until the pipeline is destroyed.
+class FramePipeline {
+    static constexpr auto IDLE = std::chrono::microseconds(200);
+
+    Simulation& simulation;
+    TripleBuffer<FrameInput> inputs;
+    TripleBuffer<Snapshot> snapshots;
+    std::atomic<bool> running;
+    std::atomic<size_t> made;
+    std::thread thread;
+
+    void loop() {
+        FixedClock clock(Simulation::TICK);
+        PipelineClock::time_point last = PipelineClock::now();
+        bool started = false;
+        size_t sequence = 0;
+
+        while (running.load(std::memory_order_acquire)) {
+            started = inputs.acquire() || started;
+            PipelineClock::time_point now = PipelineClock::now();
+            if (!started) {
+                // Nothing to simulate before the player is there
+                last = now;
+                std::this_thread::sleep_for(IDLE);
+                continue;
+            }
+            const FrameInput& input = inputs.front_slot();
+
+            clock.advance(std::chrono::duration<double>(now - last).count());
+            last = now;
+            bool ticked = false;
+            while (clock.tick()) {
+                simulation.tick(input.input);
+                ticked = true;
+            }
+
+            // A new frame once the world moved or the last one was taken;
+            // otherwise there is nothing the render thread would not already have
+            if (!ticked && snapshots.pending()) {
+                std::this_thread::sleep_for(IDLE);
+                continue;
+            }
+            Snapshot& snapshot = snapshots.back_slot();
+            simulation.emit(snapshot.buffer, clock.alpha(),
+                            input.has_camera ? Frustum(input.projection, input.view) : Frustum());
+            snapshot.stats = simulation.stats();
+            snapshot.projection = input.projection;
+            snapshot.view = input.view;
+            snapshot.input_time = input.time;
+            snapshot.sequence = ++sequence;
+            snapshots.publish();
+            made.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    FramePipeline(Simulation& simulation, bool instancing)
+    : simulation(simulation), snapshots(Snapshot(instancing)), running(true), made(0) {
+        thread = std::thread(&FramePipeline::loop, this);
+    }
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    ~FramePipeline() {
+        running.store(false, std::memory_order_release);
+        thread.join();
+    }
+
+    // Render thread: hands over the newest input
+    void submit(const FrameInput& input) {
+        inputs.back_slot() = input;
+        inputs.publish();
+    }
+
+    // Render thread: the newest finished frame, NULL before the first one.
+    // It stays valid until the next call.
+    const Snapshot* latest() {
+        snapshots.acquire();
+        const Snapshot& snapshot = snapshots.front_slot();
+        return snapshot.sequence > 0 ? &snapshot : NULL;
+    }
+
+    // Frames made so far, including the ones the render thread never took
+    size_t frames_made() const {
+        return made.load(std::memory_order_relaxed);
+    }
+};
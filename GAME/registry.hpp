@@ -0,0 +1,152 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <cassert>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+
+// Per-entity data touched every tick by expiry, collisions and motion.
+struct Body {
+    glm::vec3 position;
+    glm::vec3 previous;  // position one tick ago, for interpolated rendering
+    glm::vec3 velocity;  // units per second
+    GLfloat radius;  // for collisions
+    GLfloat extent;  // of a sphere around position holding the whole mesh, for culling
+    double lifetime;  // simulation time the entity expires at, in seconds
+};
+
+
+// Names an entity for as long as it lives. A handle to a removed entity
+// stays invalid even after its slot is reused, thanks to the generation.
+struct Handle {
+    uint32_t slot;
+    uint32_t generation;
+};
+
+
+// Slot map of entities. Live entities are kept densely packed: hot Body data
+// in one array and the cold object (mesh reference, color, vertex cache) in
+// a parallel one, both indexed by the same dense index. Removal swaps the
+// last entity into the hole, so dense indices are not stable; handles are.
+template <typename Object>
+class Registry {
+    struct Slot {
+        uint32_t index;
+        uint32_t generation;
+    };
+
+    std::vector<Body> _bodies;
+    std::vector<Object> _objects;
+    std::vector<uint32_t> _slot_of;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+
+public:
+    Handle create(const Body& body, Object object) {
+        uint32_t slot;
+        if (free_slots.empty()) {
+            slot = slots.size();
+            slots.push_back(Slot{0, 0});
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        slots[slot].index = _bodies.size();
+        _bodies.push_back(body);
+        _objects.push_back(std::move(object));
+        _slot_of.push_back(slot);
+        return Handle{slot, slots[slot].generation};
+    }
+
+    bool alive(Handle handle) const {
+        return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation;
+    }
+
+    // Dense index of a live entity
+    size_t index(Handle handle) const {
+        assert(alive(handle));
+        return slots[handle.slot].index;
+    }
+
+    Handle handle(size_t index) const {
+        uint32_t slot = _slot_of[index];
+        return Handle{slot, slots[slot].generation};
+    }
+
+    void remove(Handle handle) {
+        if (alive(handle)) {
+            remove_at(index(handle));
+        }
+    }
+
+    // O(1): the last entity takes the place of the removed one.
+    void remove_at(size_t index) {
+        size_t last = _bodies.size() - 1;
+        uint32_t slot = _slot_of[index];
+        ++slots[slot].generation;
+        free_slots.push_back(slot);
+
+        if (index != last) {
+            _bodies[index] = _bodies[last];
+            _objects[index] = std::move(_objects[last]);
+            _slot_of[index] = _slot_of[last];
+            slots[_slot_of[index]].index = index;
+        }
+        _bodies.pop_back();
+        _objects.pop_back();
+        _slot_of.pop_back();
+    }
+
+    // Removes every entity whose dense index satisfies predicate. Indices are
+    // visited from the back, so each one is checked before anything moves into it.
+    template <typename F>
+    void remove_if(F predicate) {
+        for (size_t i = _bodies.size(); i-- > 0;) {
+            if (predicate(i)) {
+                remove_at(i);
+            }
+        }
+    }
+
+    size_t size() const {
+        return _bodies.size();
+    }
+
+    bool empty() const {
+        return _bodies.empty();
+    }
+
+    Body& body(size_t index) {
+        return _bodies[index];
+    }
+
+    const Body& body(size_t index) const {
+        return _bodies[index];
+    }
+
+    Object& object(size_t index) {
+        return _objects[index];
+    }
+
+    const Object& object(size_t index) const {
+        return _objects[index];
+    }
+
+    std::vector<Body>& bodies() {
+        return _bodies;
+    }
+
+    const std::vector<Body>& bodies() const {
+        return _bodies;
+    }
+
+    const std::vector<Object>& objects() const {
+        return _objects;
+    }
+};
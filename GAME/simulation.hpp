@@ -0,0 +1,411 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <numeric>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include <thread>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "objects.hpp"
+#include "spatial_hash.hpp"
+#include "registry.hpp"
+#include "thread_pool.hpp"
+#include "frustum.hpp"
+
+
+// Everything the simulation takes from the player for one tick.
+// Filled from Controls in the game and from a script in the headless harness.
+struct Input {
+    glm::vec3 position;
+    glm::vec3 direction;
+    bool fire;
+};
+
+
+enum Phase {
+    PHASE_SPAWN,
+    PHASE_EXPIRE,
+    PHASE_COLLIDE,
+    PHASE_FIRE,
+    PHASE_MOVE,
+    PHASE_EMIT,
+    PHASES_COUNT
+};
+
+const char* const PHASE_NAMES[PHASES_COUNT] = {
+        "spawn", "expire", "collide", "fire", "move", "emit"
+};
+
+
+// Knobs for stress scenes; the defaults are the game itself.
+struct Settings {
+    float spawn_rate = 1.8f;  // targets per second
+    float fire_cooldown = 1.0f / 3;  // seconds between shots
+    size_t threads = std::thread::hardware_concurrency();  // including the calling one
+    float fireball_range = 10.0f;  // fireballs farther than this from the player are retired
+    bool lod = true;  // pick meshes by screen size, or always draw the most detailed ones
+};
+
+
+// Everything that happened since the previous rendered frame:
+// timings and collisions are summed over all ticks in between.
+struct FrameStats {
+    long long phase_ns[PHASES_COUNT];
+    size_t ticks;
+    bool has_collision;
+    size_t targets;
+    size_t fireballs;
+    size_t culled_targets;
+    size_t culled_fireballs;
+    size_t vertices;
+    size_t instances;
+    size_t triangles;  // drawn, instanced ones included
+    size_t upload_bytes;
+    size_t collision_checks;
+
+    long long total_ns() const {
+        return std::accumulate(phase_ns, phase_ns + PHASES_COUNT, 0LL);
+    }
+};
+
+
+// The world advances in fixed ticks of TICK seconds, independent of the
+// frame rate; see FixedClock for driving it from real time.
+class Simulation {
+    typedef std::chrono::steady_clock Clock;
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<float> uniform;
+
+    Registry<Target> targets;
+    Registry<Fireball> fireballs;
+    Floor floor;
+
+    size_t iteration;
+    double last_shoot_time;
+    bool verbose;
+    Settings settings;
+
+    ThreadPool pool;
+    std::vector<size_t> offsets;
+    std::vector<glm::vec3> positions;
+    std::vector<char> visible;
+
+    SpatialHash fireball_grid;
+    std::vector<char> fireball_removed;
+    std::vector<std::pair<Handle, Handle>> hits;  // target and fireball
+
+    FrameStats _stats;
+    FrameStats current;
+    Clock::time_point phase_start;
+
+    void start_phase() {
+        phase_start = Clock::now();
+    }
+
+    void finish_phase(Phase phase) {
+        auto now = Clock::now();
+        current.phase_ns[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start).count();
+        phase_start = now;
+    }
+
+    static bool are_close(const Body& lhs, const Body& rhs) {
+        glm::vec3 difference = lhs.position - rhs.position;
+        GLfloat distance = lhs.radius + rhs.radius;
+        return glm::dot(difference, difference) < distance * distance;
+    }
+
+    // Interpolates the positions of all entities alpha of the way from the
+    // previous tick to the last one, marks which of them are in the frustum
+    // and picks a level of detail for those that are. Returns how many were culled.
+    template <typename T>
+    size_t cull(Registry<T>& registry, float alpha, const Frustum& frustum) {
+        const size_t count = registry.size();
+        positions.resize(count);
+        visible.resize(count);
+        size_t culled = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const Body& body = registry.body(i);
+            positions[i] = body.previous + (body.position - body.previous) * alpha;
+            visible[i] = frustum.sees(positions[i], body.extent);
+            culled += !visible[i];
+
+            T& object = registry.object(i);
+            const LodChain* lods = object.lod_chain();
+            if (visible[i] && lods && settings.lod) {
+                object.set_level(lods->select(object.level(), frustum.screen_size(positions[i], body.extent)));
+            }
+        }
+        return culled;
+    }
+
+    // Every visible object writes its vertices straight into its own slice
+    // of the frame, found by a prefix sum over the vertex counts.
+    template <typename T>
+    size_t draw_vertices(Registry<T>& registry, Buffer& buffer, float alpha, const Frustum& frustum) {
+        const size_t count = registry.size();
+        size_t culled = cull(registry, alpha, frustum);
+        offsets.resize(count + 1);
+        offsets[0] = 0;
+        for (size_t i = 0; i < count; ++i) {
+            offsets[i + 1] = offsets[i] + (visible[i] ? registry.object(i).vertex_count() : 0);
+        }
+        Vertex* vertices = buffer.allocate(offsets[count]);
+        pool.parallel_for(count, EMIT_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                if (visible[i]) {
+                    T& object = registry.object(i);
+                    object.place(positions[i]);
+                    object.emit(vertices + offsets[i]);
+                }
+            }
+        });
+        return culled;
+    }
+
+    // Visible targets get consecutive instance slots within their level.
+    size_t draw_instances(Registry<Target>& registry, Buffer& buffer, float alpha, const Frustum& frustum) {
+        const size_t count = registry.size();
+        size_t culled = cull(registry, alpha, frustum);
+        const size_t levels = cat_lods().levels();
+        std::vector<size_t> level_counts(levels, 0);
+        offsets.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (visible[i]) {
+                offsets[i] = level_counts[registry.object(i).level()]++;
+            }
+        }
+        std::vector<Instance*> level_instances(levels);
+        for (size_t level = 0; level < levels; ++level) {
+            level_instances[level] = buffer.allocate_instances(level_counts[level], level);
+        }
+        pool.parallel_for(count, EMIT_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                if (visible[i]) {
+                    Target& object = registry.object(i);
+                    object.place(positions[i]);
+                    level_instances[object.level()][offsets[i]] = object.instance();
+                }
+            }
+        });
+        return culled;
+    }
+
+    void move(std::vector<Body>& bodies) {
+        pool.parallel_for(bodies.size(), MOVE_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                bodies[i].previous = bodies[i].position;
+                bodies[i].position += bodies[i].velocity * float(TICK);
+            }
+        });
+    }
+
+    bool fireball_is_available() const {
+        return time() - last_shoot_time > settings.fire_cooldown;
+    }
+
+    // Pairs every target with the first fireball that touches it. Fireballs
+    // are put in a grid with cells as wide as a fireball, so each target
+    // only looks at its own and neighbouring cells.
+    void collide() {
+        const std::vector<Body>& target_bodies = targets.bodies();
+        const std::vector<Body>& fireball_bodies = fireballs.bodies();
+        fireball_removed.assign(fireball_bodies.size(), 0);
+        hits.clear();
+
+        GLfloat max_radius = 0;
+        for (const auto& body : fireball_bodies) {
+            max_radius = std::max(max_radius, body.radius);
+        }
+        fireball_grid.build(fireball_bodies.size(), 2 * max_radius, [&](size_t j) {
+            return fireball_bodies[j].position;
+        });
+
+        for (size_t i = 0; i < target_bodies.size(); ++i) {
+            const Body& target = target_bodies[i];
+            const glm::vec3 reach(target.radius + max_radius);
+            size_t hit = fireball_bodies.size();
+            fireball_grid.query(target.position - reach, target.position + reach, [&](size_t j) {
+                ++current.collision_checks;
+                if (j < hit && !fireball_removed[j] && are_close(target, fireball_bodies[j])) {
+                    hit = j;
+                }
+            });
+            if (hit < fireball_bodies.size()) {
+                if (verbose) {
+                    std::cout << "COLLIDE" << std::endl;
+                }
+                fireball_removed[hit] = 1;
+                hits.emplace_back(targets.handle(i), fireballs.handle(hit));
+                current.has_collision = true;
+            }
+        }
+
+        // Handles stay valid while the entities around them are moved by removals
+        for (size_t k = hits.size(); k-- > 0;) {
+            targets.remove(hits[k].first);
+            fireballs.remove(hits[k].second);
+        }
+    }
+
+    void create_target(const glm::vec3& position) {
+        float x = uniform(generator) * 2 * 3.14;
+        float h = uniform(generator);
+        glm::vec3 center(5 * sin(x), 0.1 + 3 * h, 5 * cos(x));
+        GLfloat radius = 0.1f + 0.05 * uniform(generator);
+        glm::vec3 angle(
+                uniform(generator) * 3.14,
+                uniform(generator) * 3.14,
+                uniform(generator) * 3.14
+        );
+        std::vector<GLfloat> color({
+                                           uniform(generator),
+                                           uniform(generator),
+                                           uniform(generator)
+                                   });
+        float brightness = std::accumulate(color.begin(), color.end(), 0.f);
+        Body body;
+        body.position = center + position * 0.5f;
+        body.previous = body.position;
+        body.velocity = glm::vec3(
+                uniform(generator) * 0.6f,
+                uniform(generator) * 0.6f,
+                uniform(generator) * 0.6f
+        );
+        body.radius = radius;
+        // A thousand frames at 60 fps per unit of brightness, as before the fixed timestep
+        body.lifetime = time() + brightness * 1000 * TICK;
+        Target target(body.position, radius, angle, color);
+        body.extent = target.extent();
+        targets.create(body, std::move(target));
+    }
+
+    void create_fireball(const glm::vec3& position, const glm::vec3& direction) {
+        const GLfloat radius = 0.5;
+        Body body;
+        body.position = position - glm::vec3(0, 1, 0);
+        body.previous = body.position;
+        body.velocity = direction * 30.0f;
+        body.radius = radius;
+        body.lifetime = std::numeric_limits<double>::infinity();
+        Fireball fireball(radius, 20);
+        fireball.place(body.position);
+        body.extent = fireball.extent();
+        fireballs.create(body, std::move(fireball));
+    }
+
+public:
+    static constexpr double TICK = 1.0 / 60;
+    // Items per parallel_for chunk
+    static const size_t MOVE_GRAIN = 4096;
+    static const size_t EMIT_GRAIN = 32;
+
+    explicit Simulation(unsigned seed=std::default_random_engine::default_seed, bool verbose=false,
+                        const Settings& settings=Settings())
+    : generator(seed), uniform(0.0, 1.0), iteration(0), last_shoot_time(0), verbose(verbose),
+      settings(settings), pool(settings.threads), _stats(), current() {}
+
+    // Advances the world by one tick of TICK seconds.
+    void tick(const Input& input) {
+        start_phase();
+
+        // create targets
+        if (uniform(generator) < settings.spawn_rate * TICK) {
+            create_target(input.position);
+        }
+        finish_phase(PHASE_SPAWN);
+
+        // remove targets that lived long enough and fireballs that flew away
+        const std::vector<Body>& target_bodies = targets.bodies();
+        targets.remove_if([&](size_t i) {
+            return time() >= target_bodies[i].lifetime;
+        });
+        const std::vector<Body>& fireball_bodies = fireballs.bodies();
+        const float range = settings.fireball_range;
+        fireballs.remove_if([&](size_t i) {
+            glm::vec3 offset = fireball_bodies[i].position - input.position;
+            return glm::dot(offset, offset) > range * range;
+        });
+        finish_phase(PHASE_EXPIRE);
+
+        // remove collided objects
+        collide();
+        finish_phase(PHASE_COLLIDE);
+
+        if (input.fire && fireball_is_available()) {
+            last_shoot_time = time();
+            if (verbose) {
+                std::cout << "Fire!\n";
+            }
+            create_fireball(input.position, input.direction);
+        }
+        finish_phase(PHASE_FIRE);
+
+        move(targets.bodies());
+        move(fireballs.bodies());
+        finish_phase(PHASE_MOVE);
+
+        ++current.ticks;
+        ++iteration;
+    }
+
+    // Refills buffer with the part of the world inside frustum, as seen alpha
+    // of the way between the previous tick and the last one, and closes the
+    // frame statistics.
+    void emit(Buffer& buffer, float alpha, const Frustum& frustum=Frustum()) {
+        start_phase();
+        buffer.clear();
+        floor.draw(buffer);
+        if (buffer.instancing()) {
+            current.culled_targets = draw_instances(targets, buffer, alpha, frustum);
+        } else {
+            current.culled_targets = draw_vertices(targets, buffer, alpha, frustum);
+        }
+        current.culled_fireballs = draw_vertices(fireballs, buffer, alpha, frustum);
+        finish_phase(PHASE_EMIT);
+
+        _stats = current;
+        _stats.targets = targets.size();
+        _stats.fireballs = fireballs.size();
+        _stats.vertices = buffer.size();
+        _stats.instances = buffer.instance_count();
+        _stats.triangles = buffer.size() / 3;
+        for (size_t level = 0; level < buffer.instance_levels(); ++level) {
+            _stats.triangles += buffer.instance_count(level) * cat_lods().meshes[level]->triangles_count();
+        }
+        _stats.upload_bytes = buffer.byte_size() + buffer.instance_byte_size();
+        current = FrameStats();
+    }
+
+    // One tick per frame, drawn exactly at the tick.
+    void step(const Input& input, Buffer& buffer) {
+        tick(input);
+        emit(buffer, 1.0f);
+    }
+
+    const FrameStats& stats() const {
+        return _stats;
+    }
+
+    size_t ticks() const {
+        return iteration;
+    }
+
+    size_t threads() const {
+        return pool.threads();
+    }
+
+    // Simulation time in seconds
+    double time() const {
+        return iteration * TICK;
+    }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+
+// Uniform grid over unbounded space: cell coordinates are hashed into a table
+// sized for the number of points. Rebuilt from scratch every frame with a
+// counting sort, so each bucket is a contiguous run of point ids.
+class SpatialHash {
+    float cell_size;
+    uint32_t mask;
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> buckets;
+    std::vector<uint32_t> cursor;
+
+    int cell(float coordinate) const {
+        return (int)std::floor(coordinate / cell_size);
+    }
+
+    uint32_t bucket(int x, int y, int z) const {
+        return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u) & mask;
+    }
+
+public:
+    SpatialHash() : cell_size(1.0f), mask(0) {}
+
+    // position(i) gives the point with id i, for i in [0, count).
+    template <typename F>
+    void build(size_t count, float size, F position) {
+        cell_size = size;
+        uint32_t table_size = 64;
+        while (table_size < 2 * count) {
+            table_size *= 2;
+        }
+        mask = table_size - 1;
+
+        buckets.resize(count);
+        starts.assign(table_size + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec3 point = position(i);
+            buckets[i] = bucket(cell(point.x), cell(point.y), cell(point.z));
+            ++starts[buckets[i] + 1];
+        }
+        for (uint32_t b = 0; b < table_size; ++b) {
+            starts[b + 1] += starts[b];
+        }
+
+        ids.resize(count);
+        cursor.assign(starts.begin(), starts.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            ids[cursor[buckets[i]]++] = i;
+        }
+    }
+
+    // Calls visit(id) for every point whose cell overlaps the box [low, high].
+    // Points from other cells sharing a bucket are visited too, so callers
+    // still have to check the distance themselves.
+    template <typename F>
+    void query(const glm::vec3& low, const glm::vec3& high, F visit) const {
+        if (ids.empty()) {
+            return;
+        }
+        int x0 = cell(low.x), y0 = cell(low.y), z0 = cell(low.z);
+        int x1 = cell(high.x), y1 = cell(high.y), z1 = cell(high.z);
+        for (int x = x0; x <= x1; ++x) {
+            for (int y = y0; y <= y1; ++y) {
+                for (int z = z0; z <= z1; ++z) {
+                    uint32_t b = bucket(x, y, z);
+                    for (uint32_t k = starts[b]; k < starts[b + 1]; ++k) {
+                        visit(ids[k]);
+                    }
+                }
+            }
+        }
+    }
+};
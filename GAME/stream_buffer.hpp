@@ -0,0 +1,197 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+
+struct UploadStats {
+    size_t frames;
+    size_t bytes;
+    long long upload_ns;
+    long long stall_ns;
+
+    UploadStats() : frames(0), bytes(0), upload_ns(0), stall_ns(0) {}
+
+    double megabytes_per_second() const {
+        return upload_ns ? bytes * 1e3 / upload_ns : 0.0;
+    }
+};
+
+
+// Vertex buffer that is refilled from scratch every frame.
+//
+// PERSISTENT keeps REGIONS slices of one persistently mapped buffer and
+// writes into the slice the GPU finished with (guarded by fences), so the
+// driver never has to reallocate or synchronize.
+// ORPHAN asks the driver for fresh storage and fills it with glBufferSubData.
+// REALLOCATE is the old path: glBufferData(..., GL_STATIC_DRAW) every frame.
+class StreamBuffer {
+public:
+    enum Mode {
+        PERSISTENT,
+        ORPHAN,
+        REALLOCATE
+    };
+
+    static const int REGIONS = 3;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Mode _mode;
+    GLuint id;
+    size_t region_size;
+    size_t region;
+    char* mapped;
+    GLsync fences[REGIONS];
+
+    std::vector<char> staging;
+    size_t mapped_bytes;
+    Clock::time_point upload_start;
+
+    UploadStats _stats;
+
+    static long long ns_since(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void allocate_storage() {
+        glBindBuffer(GL_ARRAY_BUFFER, id);
+        if (_mode == PERSISTENT) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, region_size * REGIONS, NULL, flags);
+            mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, region_size * REGIONS, flags);
+        }
+    }
+
+    void release_storage() {
+        for (auto& fence : fences) {
+            wait(fence);
+        }
+        if (mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, id);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            mapped = NULL;
+        }
+        glDeleteBuffers(1, &id);
+    }
+
+    // Blocks until the GPU is done with the region the fence was put after.
+    void wait(GLsync& fence) {
+        if (!fence) {
+            return;
+        }
+        auto start = Clock::now();
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        _stats.stall_ns += ns_since(start);
+        glDeleteSync(fence);
+        fence = NULL;
+    }
+
+    void grow(size_t bytes) {
+        // Immutable storage can not be resized, so the buffer is recreated.
+        release_storage();
+        while (region_size < bytes) {
+            region_size *= 2;
+        }
+        glGenBuffers(1, &id);
+        allocate_storage();
+        region = 0;
+    }
+
+public:
+    explicit StreamBuffer(Mode mode=best_mode(), size_t region_size=1 << 20)
+    : _mode(mode), region_size(region_size), region(0), mapped(NULL), mapped_bytes(0) {
+        std::fill(fences, fences + REGIONS, (GLsync)NULL);
+        glGenBuffers(1, &id);
+        allocate_storage();
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    ~StreamBuffer() {
+        release_storage();
+    }
+
+    static Mode best_mode() {
+        if (GLEW_ARB_buffer_storage && GLEW_ARB_sync) {
+            return PERSISTENT;
+        }
+        return ORPHAN;
+    }
+
+    static const char* mode_name(Mode mode) {
+        switch (mode) {
+            case PERSISTENT: return "persistent";
+            case ORPHAN: return "orphan";
+            default: return "reallocate";
+        }
+    }
+
+    Mode mode() const {
+        return _mode;
+    }
+
+    // Returns memory for `bytes` bytes of this frame's data.
+    // The data is visible to the GPU after unmap(), at offset().
+    char* map(size_t bytes) {
+        mapped_bytes = bytes;
+        if (_mode != PERSISTENT) {
+            upload_start = Clock::now();
+            staging.resize(bytes);
+            return staging.data();
+        }
+        if (bytes > region_size) {
+            grow(bytes);
+        }
+        wait(fences[region]);
+        upload_start = Clock::now();
+        return mapped + offset();
+    }
+
+    void unmap() {
+        glBindBuffer(GL_ARRAY_BUFFER, id);
+        if (_mode == ORPHAN) {
+            if (mapped_bytes > region_size) {
+                region_size = mapped_bytes;
+            }
+            glBufferData(GL_ARRAY_BUFFER, region_size, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, mapped_bytes, staging.data());
+        } else if (_mode == REALLOCATE) {
+            glBufferData(GL_ARRAY_BUFFER, mapped_bytes, staging.data(), GL_STATIC_DRAW);
+        }
+        _stats.upload_ns += ns_since(upload_start);
+        _stats.bytes += mapped_bytes;
+    }
+
+    // Must be called after the draw calls that read this frame's data.
+    void fence() {
+        if (_mode == PERSISTENT) {
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (region + 1) % REGIONS;
+        }
+        ++_stats.frames;
+    }
+
+    GLuint buffer() const {
+        return id;
+    }
+
+    size_t offset() const {
+        return _mode == PERSISTENT ? region * region_size : 0;
+    }
+
+    const UploadStats& stats() const {
+        return _stats;
+    }
+
+    void reset_stats() {
+        _stats = UploadStats();
+    }
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+
+// Work-stealing pool for data-parallel loops. parallel_for cuts a range into
+// chunks and deals contiguous runs of them to per-thread queues. A thread
+// takes work from the front of its own queue and, once that is empty,
+// steals from the back of the others. The calling thread works as thread 0.
+class ThreadPool {
+    struct Task {
+        const std::function<void(size_t, size_t)>* job;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    size_t generation;
+    bool stopping;
+    std::atomic<size_t> pending;
+
+    bool pop(size_t index, Task& task) {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.tasks.empty()) {
+            return false;
+        }
+        task = own.tasks.front();
+        own.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(size_t index, Task& task) {
+        for (size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = *queues[(index + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs tasks until none are left to take; returns whether it ran any.
+    bool work(size_t index) {
+        bool worked = false;
+        Task task;
+        while (pop(index, task) || steal(index, task)) {
+            (*task.job)(task.begin, task.end);
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+            worked = true;
+        }
+        return worked;
+    }
+
+    void worker_loop(size_t index) {
+        size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+            work(index);
+        }
+    }
+
+public:
+    // threads counts the calling thread, so ThreadPool(1) starts no workers.
+    explicit ThreadPool(size_t threads=std::thread::hardware_concurrency())
+    : generation(0), stopping(false), pending(0) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) {
+            queues.emplace_back(new Queue());
+        }
+        for (size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t threads() const {
+        return queues.size();
+    }
+
+    // Calls job(begin, end) over [0, count) in chunks of about grain items
+    // and returns when all of them are done. Not reentrant.
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& job) {
+        grain = std::max<size_t>(grain, 1);
+        if (queues.size() == 1 || count <= grain) {
+            if (count > 0) {
+                job(0, count);
+            }
+            return;
+        }
+
+        const size_t chunks = (count + grain - 1) / grain;
+        pending.store(chunks, std::memory_order_release);
+        for (size_t q = 0; q < queues.size(); ++q) {
+            size_t first = chunks * q / queues.size();
+            size_t last = chunks * (q + 1) / queues.size();
+            std::lock_guard<std::mutex> lock(queues[q]->mutex);
+            for (size_t c = first; c < last; ++c) {
+                queues[q]->tasks.push_back(Task{&job, c * grain, std::min(count, (c + 1) * grain)});
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            ++generation;
+        }
+        wake.notify_all();
+
+        work(0);
+        // Whatever is left is already running on other threads
+        while (pending.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+    }
+};
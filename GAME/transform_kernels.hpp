@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+
+// Batch transforms over vertex arrays kept as structure of arrays (see Mesh).
+// Every kernel exists in a scalar, an SSE and an AVX2 version; the widest one
+// the CPU supports is picked at runtime. Output arrays may alias the input.
+namespace Kernels {
+
+enum Isa {
+    SCALAR,
+    SSE,
+    AVX2,
+    ISA_COUNT
+};
+
+const char* const ISA_NAMES[ISA_COUNT] = {"scalar", "sse", "avx2"};
+
+// Rotation of the old Triangle::turn (LegacyTriangle in bench_transform.cpp): around z by angle.x, around y by -angle.y, around z by angle.z.
+inline glm::mat3 euler_rotation(const glm::vec3& angle) {
+    float sin1 = sin(angle.x), cos1 = cos(angle.x);
+    float sin2 = sin(angle.y), cos2 = cos(angle.y);
+    float sin3 = sin(angle.z), cos3 = cos(angle.z);
+
+    glm::mat3 first(glm::vec3(cos1, sin1, 0), glm::vec3(-sin1, cos1, 0), glm::vec3(0, 0, 1));
+    glm::mat3 second(glm::vec3(cos2, 0, sin2), glm::vec3(0, 1, 0), glm::vec3(-sin2, 0, cos2));
+    glm::mat3 third(glm::vec3(cos3, sin3, 0), glm::vec3(-sin3, cos3, 0), glm::vec3(0, 0, 1));
+    return third * second * first;
+}
+
+struct KernelSet {
+    void (*translate)(float* x, float* y, float* z, size_t n, const glm::vec3& shift);
+    void (*scale)(float* x, float* y, float* z, size_t n, float alpha);
+    // out = matrix * in + shift
+    void (*transform)(const float* x, const float* y, const float* z,
+                      float* out_x, float* out_y, float* out_z, size_t n,
+                      const glm::mat3& matrix, const glm::vec3& shift);
+};
+
+
+namespace Scalar {
+
+inline void translate(float* x, float* y, float* z, size_t n, const glm::vec3& shift) {
+    for (size_t i = 0; i < n; ++i) {
+        x[i] += shift.x;
+        y[i] += shift.y;
+        z[i] += shift.z;
+    }
+}
+
+inline void scale(float* x, float* y, float* z, size_t n, float alpha) {
+    for (size_t i = 0; i < n; ++i) {
+        x[i] *= alpha;
+        y[i] *= alpha;
+        z[i] *= alpha;
+    }
+}
+
+inline void transform(const float* x, const float* y, const float* z,
+                      float* out_x, float* out_y, float* out_z, size_t n,
+                      const glm::mat3& m, const glm::vec3& shift) {
+    for (size_t i = 0; i < n; ++i) {
+        float px = x[i], py = y[i], pz = z[i];
+        out_x[i] = m[0][0] * px + m[1][0] * py + m[2][0] * pz + shift.x;
+        out_y[i] = m[0][1] * px + m[1][1] * py + m[2][1] * pz + shift.y;
+        out_z[i] = m[0][2] * px + m[1][2] * py + m[2][2] * pz + shift.z;
+    }
+}
+
+}  // namespace Scalar
+
+
+#ifdef KERNELS_X86
+
+namespace Sse {
+
+inline void translate(float* x, float* y, float* z, size_t n, const glm::vec3& shift) {
+    const __m128 sx = _mm_set1_ps(shift.x), sy = _mm_set1_ps(shift.y), sz = _mm_set1_ps(shift.z);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), sx));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), sy));
+        _mm_storeu_ps(z + i, _mm_add_ps(_mm_loadu_ps(z + i), sz));
+    }
+    Scalar::translate(x + i, y + i, z + i, n - i, shift);
+}
+
+inline void scale(float* x, float* y, float* z, size_t n, float alpha) {
+    const __m128 a = _mm_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), a));
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(y + i), a));
+        _mm_storeu_ps(z + i, _mm_mul_ps(_mm_loadu_ps(z + i), a));
+    }
+    Scalar::scale(x + i, y + i, z + i, n - i, alpha);
+}
+
+inline void transform(const float* x, const float* y, const float* z,
+                      float* out_x, float* out_y, float* out_z, size_t n,
+                      const glm::mat3& m, const glm::vec3& shift) {
+    const __m128 m00 = _mm_set1_ps(m[0][0]), m10 = _mm_set1_ps(m[1][0]), m20 = _mm_set1_ps(m[2][0]);
+    const __m128 m01 = _mm_set1_ps(m[0][1]), m11 = _mm_set1_ps(m[1][1]), m21 = _mm_set1_ps(m[2][1]);
+    const __m128 m02 = _mm_set1_ps(m[0][2]), m12 = _mm_set1_ps(m[1][2]), m22 = _mm_set1_ps(m[2][2]);
+    const __m128 sx = _mm_set1_ps(shift.x), sy = _mm_set1_ps(shift.y), sz = _mm_set1_ps(shift.z);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, px), _mm_mul_ps(m10, py)), _mm_add_ps(_mm_mul_ps(m20, pz), sx));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, px), _mm_mul_ps(m11, py)), _mm_add_ps(_mm_mul_ps(m21, pz), sy));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, px), _mm_mul_ps(m12, py)), _mm_add_ps(_mm_mul_ps(m22, pz), sz));
+        _mm_storeu_ps(out_x + i, rx);
+        _mm_storeu_ps(out_y + i, ry);
+        _mm_storeu_ps(out_z + i, rz);
+    }
+    Scalar::transform(x + i, y + i, z + i, out_x + i, out_y + i, out_z + i, n - i, m, shift);
+}
+
+}  // namespace Sse
+
+
+namespace Avx2 {
+
+__attribute__((target("avx2")))
+inline void translate(float* x, float* y, float* z, size_t n, const glm::vec3& shift) {
+    const __m256 sx = _mm256_set1_ps(shift.x), sy = _mm256_set1_ps(shift.y), sz = _mm256_set1_ps(shift.z);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), sx));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), sy));
+        _mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_loadu_ps(z + i), sz));
+    }
+    Sse::translate(x + i, y + i, z + i, n - i, shift);
+}
+
+__attribute__((target("avx2")))
+inline void scale(float* x, float* y, float* z, size_t n, float alpha) {
+    const __m256 a = _mm256_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), a));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), a));
+        _mm256_storeu_ps(z + i, _mm256_mul_ps(_mm256_loadu_ps(z + i), a));
+    }
+    Sse::scale(x + i, y + i, z + i, n - i, alpha);
+}
+
+__attribute__((target("avx2")))
+inline void transform(const float* x, const float* y, const float* z,
+                      float* out_x, float* out_y, float* out_z, size_t n,
+                      const glm::mat3& m, const glm::vec3& shift) {
+    const __m256 m00 = _mm256_set1_ps(m[0][0]), m10 = _mm256_set1_ps(m[1][0]), m20 = _mm256_set1_ps(m[2][0]);
+    const __m256 m01 = _mm256_set1_ps(m[0][1]), m11 = _mm256_set1_ps(m[1][1]), m21 = _mm256_set1_ps(m[2][1]);
+    const __m256 m02 = _mm256_set1_ps(m[0][2]), m12 = _mm256_set1_ps(m[1][2]), m22 = _mm256_set1_ps(m[2][2]);
+    const __m256 sx = _mm256_set1_ps(shift.x), sy = _mm256_set1_ps(shift.y), sz = _mm256_set1_ps(shift.z);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+        __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, px), _mm256_mul_ps(m10, py)), _mm256_add_ps(_mm256_mul_ps(m20, pz), sx));
+        __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m01, px), _mm256_mul_ps(m11, py)), _mm256_add_ps(_mm256_mul_ps(m21, pz), sy));
+        __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m02, px), _mm256_mul_ps(m12, py)), _mm256_add_ps(_mm256_mul_ps(m22, pz), sz));
+        _mm256_storeu_ps(out_x + i, rx);
+        _mm256_storeu_ps(out_y + i, ry);
+        _mm256_storeu_ps(out_z + i, rz);
+    }
+    Sse::transform(x + i, y + i, z + i, out_x + i, out_y + i, out_z + i, n - i, m, shift);
+}
+
+}  // namespace Avx2
+
+#endif  // KERNELS_X86
+
+
+inline bool supported(Isa isa) {
+#ifdef KERNELS_X86
+    if (isa == AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    return true;
+#else
+    return isa == SCALAR;
+#endif
+}
+
+inline const KernelSet& kernels(Isa isa) {
+    static const KernelSet sets[ISA_COUNT] = {
+            {Scalar::translate, Scalar::scale, Scalar::transform},
+#ifdef KERNELS_X86
+            {Sse::translate, Sse::scale, Sse::transform},
+            {Avx2::translate, Avx2::scale, Avx2::transform},
+#else
+            {Scalar::translate, Scalar::scale, Scalar::transform},
+            {Scalar::translate, Scalar::scale, Scalar::transform},
+#endif
+    };
+    return sets[isa];
+}
+
+inline Isa best_isa() {
+    static const Isa isa = supported(AVX2) ? AVX2 : (supported(SSE) ? SSE : SCALAR);
+    return isa;
+}
+
+// Kernels for the widest instruction set of this CPU
+inline const KernelSet& kernels() {
+    return kernels(best_isa());
+}
+
+}  // namespace Kernels
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+
+
+// Hands the newest value from one writer thread to one reader thread without
+// locks and without either side ever waiting. The writer fills its back slot
+// and publishes it as the middle one; the reader swaps the middle slot for its
+// front one whenever something new was published. Values the reader did not
+// get to in time are simply overwritten.
+template <typename T>
+class TripleBuffer {
+    static const unsigned INDEX = 3;
+    static const unsigned FRESH = 4;  // the middle slot was published after the reader last looked
+
+    T slots[3];
+    std::atomic<unsigned> middle;
+    unsigned back;   // touched by the writer only
+    unsigned front;  // touched by the reader only
+
+public:
+    TripleBuffer() : middle(1), back(2), front(0) {}
+
+    // Every slot starts as a copy of initial
+    explicit TripleBuffer(const T& initial) : slots{initial, initial, initial}, middle(1), back(2), front(0) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    T& back_slot() {
+        return slots[back];
+    }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Whether the reader has not taken the last published value yet
+    bool pending() const {
+        return middle.load(std::memory_order_acquire) & FRESH;
+    }
+
+    // Reader side: moves to the newest published value, if there is one
+    bool acquire() {
+        if (!pending()) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front_slot() const {
+        return slots[front];
+    }
+};
@@ -0,0 +1,239 @@
+#ifndef BC_ENCODER_HPP
+#define BC_ENCODER_HPP
+
+// BC1 (DXT1) and BC3 (DXT5) compression of BGRA8 images, for textures the
+// GPU samples straight from their compressed form. Every 4x4 block gets the
+// two ends of its colour bounding box, pulled in by a sixteenth to keep
+// outliers from wasting the range, and every texel the nearest of the four
+// colours between them; BC3 adds the alpha channel the same way with eight
+// levels. It is the quick end of the quality range, fine for encoding at
+// load time. The bounding box and the projections onto the colour line use
+// SSE2 where it is there; rows of blocks are spread over threads.
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+namespace bc {
+
+	inline size_t blocks(uint32_t size) {
+		return (size + 3) / 4;
+	}
+
+	// Bytes of an image compressed with alpha (BC3) or without (BC1)
+	inline size_t encodedSize(uint32_t width, uint32_t height, bool alpha) {
+		return blocks(width) * blocks(height) * (alpha ? 16 : 8);
+	}
+
+	inline uint16_t to565(int r, int g, int b) {
+		return uint16_t(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+	}
+
+	// Back to 8 bits a channel, as the GPU expands it
+	inline void from565(uint16_t c, int color[3]) {
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		color[0] = (b << 3) | (b >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (r << 3) | (r >> 2);
+	}
+
+	// The 4x4 texels at block (bx, by), BGRA, rows as they are in memory;
+	// past the edge of the image the last row and column repeat
+	inline void fetchBlock(const uint8_t* image, uint32_t width, uint32_t height, size_t bx, size_t by,
+	                       uint8_t block[64]) {
+		if (bx * 4 + 4 <= width && by * 4 + 4 <= height) {
+			for (size_t y = 0; y < 4; ++y) {
+				memcpy(block + y * 16, image + ((by * 4 + y) * width + bx * 4) * 4, 16);
+			}
+			return;
+		}
+		for (size_t y = 0; y < 4; ++y) {
+			size_t row = std::min<size_t>(by * 4 + y, height - 1);
+			for (size_t x = 0; x < 4; ++x) {
+				size_t column = std::min<size_t>(bx * 4 + x, width - 1);
+				memcpy(block + (y * 4 + x) * 4, image + (row * width + column) * 4, 4);
+			}
+		}
+	}
+
+	// Smallest and largest value of every channel
+	inline void bounds(const uint8_t block[64], uint8_t low[4], uint8_t high[4]) {
+#ifdef __SSE2__
+		__m128i rows[4];
+		for (int i = 0; i < 4; ++i) {
+			rows[i] = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+		}
+		__m128i min = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+		__m128i max = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+		// Fold the four texels of a register onto the first one
+		min = _mm_min_epu8(min, _mm_shuffle_epi32(min, _MM_SHUFFLE(1, 0, 3, 2)));
+		max = _mm_max_epu8(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(1, 0, 3, 2)));
+		min = _mm_min_epu8(min, _mm_shuffle_epi32(min, _MM_SHUFFLE(2, 3, 0, 1)));
+		max = _mm_max_epu8(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(2, 3, 0, 1)));
+		uint32_t packed = _mm_cvtsi128_si32(min);
+		memcpy(low, &packed, 4);
+		packed = _mm_cvtsi128_si32(max);
+		memcpy(high, &packed, 4);
+#else
+		for (int c = 0; c < 4; ++c) {
+			low[c] = high[c] = block[c];
+		}
+		for (int i = 1; i < 16; ++i) {
+			for (int c = 0; c < 4; ++c) {
+				low[c] = std::min(low[c], block[i * 4 + c]);
+				high[c] = std::max(high[c], block[i * 4 + c]);
+			}
+		}
+#endif
+	}
+
+	// (texel - origin) . axis over the colour channels of every texel
+	inline void project(const uint8_t block[64], const int origin[3], const int axis[3], int dots[16]) {
+#ifdef __SSE2__
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i offset = _mm_setr_epi16(origin[0], origin[1], origin[2], 0, origin[0], origin[1], origin[2], 0);
+		const __m128i weights = _mm_setr_epi16(axis[0], axis[1], axis[2], 0, axis[0], axis[1], axis[2], 0);
+		for (int i = 0; i < 4; ++i) {
+			__m128i texels = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+			// Two texels a register, 16 bits a channel; madd leaves b*w+g*w and r*w+0 for each
+			__m128i low = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(texels, zero), offset), weights);
+			__m128i high = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(texels, zero), offset), weights);
+			__m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high),
+			                                               _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high),
+			                                              _MM_SHUFFLE(3, 1, 3, 1)));
+			_mm_storeu_si128((__m128i*)(dots + 4 * i), _mm_add_epi32(even, odd));
+		}
+#else
+		for (int i = 0; i < 16; ++i) {
+			dots[i] = 0;
+			for (int c = 0; c < 3; ++c) {
+				dots[i] += (block[i * 4 + c] - origin[c]) * axis[c];
+			}
+		}
+#endif
+	}
+
+	inline void encodeColor(const uint8_t block[64], uint8_t out[8]) {
+		uint8_t low[4];
+		uint8_t high[4];
+		bounds(block, low, high);
+		for (int c = 0; c < 3; ++c) {
+			int inset = (high[c] - low[c]) >> 4;
+			low[c] += inset;
+			high[c] -= inset;
+		}
+		uint16_t c0 = to565(high[2], high[1], high[0]);
+		uint16_t c1 = to565(low[2], low[1], low[0]);
+		// c0 > c1 picks the four colour mode
+		if (c0 < c1) {
+			std::swap(c0, c1);
+		}
+		out[0] = c0 & 0xff;
+		out[1] = c0 >> 8;
+		out[2] = c1 & 0xff;
+		out[3] = c1 >> 8;
+		if (c0 == c1) {
+			memset(out + 4, 0, 4);
+			return;
+		}
+
+		int end0[3];
+		int end1[3];
+		from565(c0, end0);
+		from565(c1, end1);
+		int axis[3] = {end0[0] - end1[0], end0[1] - end1[1], end0[2] - end1[2]};
+		int length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		int dots[16];
+		project(block, end1, axis, dots);
+
+		// Steps of a third from c1 to c0, in the order BC1 numbers its colours
+		static const uint8_t INDEX[4] = {1, 3, 2, 0};
+		uint32_t indices = 0;
+		for (int i = 0; i < 16; ++i) {
+			int step = (dots[i] * 6 + length) / (2 * length);
+			step = std::min(std::max(step, 0), 3);
+			indices |= uint32_t(INDEX[step]) << (2 * i);
+		}
+		memcpy(out + 4, &indices, 4);
+	}
+
+	inline void encodeAlpha(const uint8_t block[64], uint8_t out[8]) {
+		int a0 = block[3];
+		int a1 = block[3];
+		for (int i = 1; i < 16; ++i) {
+			a0 = std::max<int>(a0, block[i * 4 + 3]);
+			a1 = std::min<int>(a1, block[i * 4 + 3]);
+		}
+		out[0] = a0;
+		out[1] = a1;
+		uint64_t indices = 0;
+		if (a0 > a1) {
+			// a0 > a1 picks eight levels: a0, a1, then sevenths from a0 down to a1
+			for (int i = 0; i < 16; ++i) {
+				int step = ((block[i * 4 + 3] - a1) * 14 + (a0 - a1)) / (2 * (a0 - a1));
+				uint64_t index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+				indices |= index << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; ++i) {
+			out[2 + i] = uint8_t(indices >> (8 * i));
+		}
+	}
+
+	// Compresses a BGRA image to BC3 if alpha, else BC1, into out
+	// (encodedSize bytes), rows of blocks split over threads
+	inline void encode(const uint8_t* image, uint32_t width, uint32_t height, bool alpha, uint8_t* out,
+	                   unsigned threads=std::thread::hardware_concurrency()) {
+		const size_t columns = blocks(width);
+		const size_t rows = blocks(height);
+		const size_t block_bytes = alpha ? 16 : 8;
+		auto encodeRows = [&](size_t first, size_t last) {
+			uint8_t block[64];
+			for (size_t by = first; by < last; ++by) {
+				for (size_t bx = 0; bx < columns; ++bx) {
+					uint8_t* target = out + (by * columns + bx) * block_bytes;
+					fetchBlock(image, width, height, bx, by, block);
+					if (alpha) {
+						encodeAlpha(block, target);
+						target += 8;
+					}
+					encodeColor(block, target);
+				}
+			}
+		};
+
+		// Not worth a thread below a few thousand blocks
+		threads = std::max<size_t>(1, std::min<size_t>(threads, columns * rows / 4096));
+		std::vector<std::thread> workers;
+		for (unsigned t = 1; t < threads; ++t) {
+			workers.emplace_back(encodeRows, rows * t / threads, rows * (t + 1) / threads);
+		}
+		encodeRows(0, rows / threads);
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	// Whether any texel is not fully opaque
+	inline bool hasAlpha(const uint8_t* image, uint32_t width, uint32_t height) {
+		for (size_t i = 0; i < size_t(width) * height; ++i) {
+			if (image[i * 4 + 3] != 255) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+} // namespace bc
+
+#endif
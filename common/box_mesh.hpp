@@ -0,0 +1,675 @@
+#ifndef BOX_MESH_HPP
+#define BOX_MESH_HPP
+
+// The surface of a union of axis-aligned boxes on an integer grid, for
+// models built out of boxes like the cat and the hamster. Instead of twelve
+// triangles for every box, the boxes are rasterized into unit cells and only
+// cell faces with a filled cell on one side and an empty one on the other
+// are kept, so faces where boxes touch disappear. The kept faces of every
+// plane are merged greedily into rectangles, one part (colour) at a time.
+// A box can also be a wedge: the corner tetrahedron on its first corner,
+// with edges of length one (the cat's ears). The result is closed, with
+// every triangle wound counterclockwise seen from outside. Where a merged
+// face ends in the middle of another face's edge (a T-junction) that edge
+// is split, so that every edge is shared by exactly two triangles and no
+// crack can open between them when they are rasterized.
+// A closed surface of triangles has 2V - 4 of them for V vertices, and the
+// splits add vertices, so one surface around all boxes can take more
+// triangles than the boxes drawn one by one. The boxes are therefore meshed
+// in pieces, each closed on its own, and only boxes that save triangles
+// together share a piece; pieces overlap where their boxes touch.
+// Everything is constexpr and works in fixed-size arrays, so a mesh can be
+// made at compile time as well as at run time.
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace box_mesh {
+
+	const int MAX_CELLS = 32;
+	const size_t MAX_PARTS = 8;
+	const size_t MAX_VERTICES = 1024;
+	const size_t MAX_INDICES = 6144;
+	const size_t MAX_POLYGONS = 1024;
+	const size_t MAX_RING = 64;
+	const size_t MAX_WEDGES = 16;
+	const size_t MAX_BOXES = 64;
+
+	// Between corners (x, y, z) and (a, b, c), or the wedge in that box on (x, y, z)
+	struct Box {
+		int x, y, z;
+		int a, b, c;
+		bool wedge;
+		size_t part;
+	};
+
+	struct Point {
+		int c[3] = {0, 0, 0};
+
+		constexpr bool operator==(const Point& other) const {
+			return c[0] == other.c[0] && c[1] == other.c[1] && c[2] == other.c[2];
+		}
+	};
+
+	// A convex face: its corners counterclockwise from outside
+	struct Polygon {
+		Point corners[4];
+		size_t count = 0;
+		size_t part = 0;
+	};
+
+	// A face of a filled cell the wedge on it covers half of, keyed by the
+	// axis and direction of its normal, its plane and its cell in that plane
+	struct Covered {
+		int axis = 0;
+		int direction = 0;
+		int plane = 0;
+		int u = 0;
+		int v = 0;
+		Point a, b, c;  // the other half, which stays visible
+	};
+
+	constexpr Point point(int x, int y, int z) {
+		Point p;
+		p.c[0] = x;
+		p.c[1] = y;
+		p.c[2] = z;
+		return p;
+	}
+
+	constexpr Point along(Point p, int axis, int distance) {
+		p.c[axis] += distance;
+		return p;
+	}
+
+	constexpr long long cross(const Point& o, const Point& a, const Point& b, int axis) {
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+		return (long long)(a.c[u] - o.c[u]) * (b.c[v] - o.c[v]) - (long long)(a.c[v] - o.c[v]) * (b.c[u] - o.c[u]);
+	}
+
+	// Whether p lies on the segment from a to b, not at its ends
+	constexpr bool inside(const Point& a, const Point& b, const Point& p) {
+		for (int axis = 0; axis < 3; ++axis) {
+			if (cross(a, b, p, axis) != 0) {
+				return false;
+			}
+		}
+		long long along = 0;
+		long long length = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			along += (long long)(p.c[axis] - a.c[axis]) * (b.c[axis] - a.c[axis]);
+			length += (long long)(b.c[axis] - a.c[axis]) * (b.c[axis] - a.c[axis]);
+		}
+		return along > 0 && along < length;
+	}
+
+	constexpr long long distance(const Point& a, const Point& b) {
+		long long squared = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			squared += (long long)(b.c[axis] - a.c[axis]) * (b.c[axis] - a.c[axis]);
+		}
+		return squared;
+	}
+
+	// A triangle wound counterclockwise around the given outward normal
+	constexpr Polygon triangle(Point a, Point b, Point c, const int normal[3], size_t part) {
+		long long facing = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			facing += cross(a, b, c, axis) * normal[axis];
+		}
+		Polygon polygon;
+		polygon.corners[0] = a;
+		polygon.corners[1] = facing >= 0 ? b : c;
+		polygon.corners[2] = facing >= 0 ? c : b;
+		polygon.count = 3;
+		polygon.part = part;
+		return polygon;
+	}
+
+} // namespace box_mesh
+
+
+// The result: positions, triangles and the range of indices of every part,
+// and the closed piece every triangle belongs to
+struct BoxMesh {
+	struct Range {
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	bool valid = false;  // false if the boxes do not fit the fixed sizes above
+	size_t vertex_count = 0;
+	size_t index_count = 0;
+	size_t part_count = 0;
+	size_t piece_count = 0;
+	float positions[3 * box_mesh::MAX_VERTICES] = {};
+	uint32_t indices[box_mesh::MAX_INDICES] = {};
+	Range parts[box_mesh::MAX_PARTS] = {};
+	unsigned char pieces[box_mesh::MAX_INDICES / 3] = {};
+};
+
+
+namespace box_mesh {
+
+	class Mesher {
+		int low[3] = {0, 0, 0};
+		int size[3] = {0, 0, 0};
+		// Part + 1 of every filled cell, 0 if empty
+		unsigned char cells[MAX_CELLS][MAX_CELLS][MAX_CELLS] = {};
+		Covered covered[MAX_WEDGES];
+		size_t covered_count = 0;
+		Polygon polygons[MAX_POLYGONS];
+		size_t polygon_count = 0;
+		Point vertices[MAX_VERTICES];
+		size_t vertex_count = 0;
+		bool ok = true;
+
+		constexpr int cell(int x, int y, int z) const {
+			x -= low[0];
+			y -= low[1];
+			z -= low[2];
+			if (x < 0 || y < 0 || z < 0 || x >= size[0] || y >= size[1] || z >= size[2]) {
+				return 0;
+			}
+			return cells[x][y][z];
+		}
+
+		constexpr int cell(const int at[3]) const {
+			return cell(at[0], at[1], at[2]);
+		}
+
+		constexpr void add(const Polygon& polygon) {
+			if (polygon_count == MAX_POLYGONS) {
+				ok = false;
+				return;
+			}
+			polygons[polygon_count++] = polygon;
+		}
+
+		constexpr size_t vertex(const Point& p) {
+			for (size_t i = 0; i < vertex_count; ++i) {
+				if (vertices[i] == p) {
+					return i;
+				}
+			}
+			if (vertex_count == MAX_VERTICES) {
+				ok = false;
+				return 0;
+			}
+			vertices[vertex_count] = p;
+			return vertex_count++;
+		}
+
+		constexpr bool flat(size_t a, size_t b, size_t c) const {
+			for (int axis = 0; axis < 3; ++axis) {
+				if (cross(vertices[a], vertices[b], vertices[c], axis) != 0) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		constexpr const Covered* findCovered(int axis, int direction, int plane, int u, int v) const {
+			for (size_t i = 0; i < covered_count; ++i) {
+				const Covered& face = covered[i];
+				if (face.axis == axis && face.direction == direction && face.plane == plane && face.u == u
+				    && face.v == v) {
+					return &face;
+				}
+			}
+			return nullptr;
+		}
+
+		constexpr void fill(const Box& box) {
+			for (int x = std::min(box.x, box.a); x < std::max(box.x, box.a); ++x) {
+				for (int y = std::min(box.y, box.b); y < std::max(box.y, box.b); ++y) {
+					for (int z = std::min(box.z, box.c); z < std::max(box.z, box.c); ++z) {
+						unsigned char& filled = cells[x - low[0]][y - low[1]][z - low[2]];
+						// Where boxes overlap the first one keeps the cell
+						if (filled == 0) {
+							filled = (unsigned char)(box.part + 1);
+						}
+					}
+				}
+			}
+		}
+
+		// The faces of a wedge that are not on a filled cell, and the halves
+		// of the cell faces it stands on
+		constexpr void wedge(const Box& box) {
+			const int corner[3] = {box.x, box.y, box.z};
+			const int sign[3] = {box.a > box.x ? 1 : -1, box.b > box.y ? 1 : -1, box.c > box.z ? 1 : -1};
+			const int inner[3] = {std::min(box.x, box.a), std::min(box.y, box.b), std::min(box.z, box.c)};
+			if (box.a - box.x != sign[0] || box.b - box.y != sign[1] || box.c - box.z != sign[2] || cell(inner) != 0) {
+				ok = false;
+				return;
+			}
+			const Point p = point(box.x, box.y, box.z);
+
+			for (int axis = 0; axis < 3; ++axis) {
+				const int u = (axis + 1) % 3;
+				const int v = (axis + 2) % 3;
+				const Point a = along(p, u, sign[u]);
+				const Point b = along(p, v, sign[v]);
+				int beside[3] = {inner[0], inner[1], inner[2]};
+				beside[axis] -= sign[axis];
+				const int part = cell(beside);
+				if (part == 0) {
+					int normal[3] = {0, 0, 0};
+					normal[axis] = -sign[axis];
+					add(triangle(p, a, b, normal, box.part));
+					continue;
+				}
+				// Standing on a filled cell: that cell's face keeps its other half
+				if (covered_count == MAX_WEDGES) {
+					ok = false;
+					return;
+				}
+				Covered& face = covered[covered_count++];
+				face.axis = axis;
+				face.direction = sign[axis];
+				face.plane = corner[axis];
+				face.u = inner[u];
+				face.v = inner[v];
+				face.a = a;
+				face.b = along(a, v, sign[v]);
+				face.c = b;
+			}
+
+			int normal[3] = {sign[0], sign[1], sign[2]};
+			add(triangle(along(p, 0, sign[0]), along(p, 1, sign[1]), along(p, 2, sign[2]), normal, box.part));
+		}
+
+		// The visible faces in the plane at coordinate plane of axis, facing
+		// direction, merged into rectangles
+		constexpr void slice(int axis, int direction, int plane) {
+			const int u = (axis + 1) % 3;
+			const int v = (axis + 2) % 3;
+			int mask[MAX_CELLS][MAX_CELLS] = {};
+			for (int i = 0; i < size[u]; ++i) {
+				for (int j = 0; j < size[v]; ++j) {
+					int at[3] = {0, 0, 0};
+					at[u] = low[u] + i;
+					at[v] = low[v] + j;
+					at[axis] = direction > 0 ? plane - 1 : plane;
+					const int part = cell(at);
+					at[axis] += direction;
+					if (part == 0 || cell(at) != 0) {
+						continue;
+					}
+					if (const Covered* face = findCovered(axis, direction, plane, low[u] + i, low[v] + j)) {
+						int normal[3] = {0, 0, 0};
+						normal[axis] = direction;
+						add(triangle(face->a, face->b, face->c, normal, part - 1));
+						continue;
+					}
+					mask[i][j] = part;
+				}
+			}
+
+			for (int j = 0; j < size[v]; ++j) {
+				for (int i = 0; i < size[u];) {
+					const int part = mask[i][j];
+					if (part == 0) {
+						++i;
+						continue;
+					}
+					int width = 1;
+					while (i + width < size[u] && mask[i + width][j] == part) {
+						++width;
+					}
+					int height = 1;
+					for (bool grows = true; grows && j + height < size[v];) {
+						for (int k = 0; k < width; ++k) {
+							grows = grows && mask[i + k][j + height] == part;
+						}
+						height += grows ? 1 : 0;
+					}
+					for (int l = 0; l < height; ++l) {
+						for (int k = 0; k < width; ++k) {
+							mask[i + k][j + l] = 0;
+						}
+					}
+
+					Point corner;
+					corner.c[axis] = plane;
+					corner.c[u] = (low[u] + i);
+					corner.c[v] = (low[v] + j);
+					Polygon rectangle;
+					rectangle.count = 4;
+					rectangle.part = part - 1;
+					rectangle.corners[0] = corner;
+					rectangle.corners[1] = along(corner, u, width);
+					rectangle.corners[2] = along(along(corner, u, width), v, height);
+					rectangle.corners[3] = along(corner, v, height);
+					if (direction < 0) {
+						Point swapped = rectangle.corners[1];
+						rectangle.corners[1] = rectangle.corners[3];
+						rectangle.corners[3] = swapped;
+					}
+					add(rectangle);
+					i += width;
+				}
+			}
+		}
+
+		// Triangles of a polygon; watertight, with every vertex that lies on
+		// its edges, so no triangle edge ends halfway along another one
+		constexpr void triangulate(const Polygon& polygon, bool watertight, BoxMesh& mesh) {
+			size_t ring[MAX_RING] = {};
+			size_t ring_count = 0;
+			for (size_t k = 0; k < polygon.count; ++k) {
+				const Point& a = polygon.corners[k];
+				const Point& b = polygon.corners[(k + 1) % polygon.count];
+				const size_t first = ring_count;
+				ring[ring_count++] = vertex(a);
+				for (size_t i = 0; watertight && i < vertex_count; ++i) {
+					if (!inside(a, b, vertices[i])) {
+						continue;
+					}
+					if (ring_count == MAX_RING) {
+						ok = false;
+						return;
+					}
+					// Insertion sort by the distance from a
+					size_t at = ring_count++;
+					for (; at > first + 1 && distance(a, vertices[ring[at - 1]]) > distance(a, vertices[i]); --at) {
+						ring[at] = ring[at - 1];
+					}
+					ring[at] = i;
+				}
+			}
+
+			auto emit = [&](size_t a, size_t b, size_t c) {
+				if (mesh.index_count + 3 > MAX_INDICES) {
+					ok = false;
+					return;
+				}
+				mesh.indices[mesh.index_count++] = uint32_t(a);
+				mesh.indices[mesh.index_count++] = uint32_t(b);
+				mesh.indices[mesh.index_count++] = uint32_t(c);
+			};
+
+			// Clip ears off the ring, never one that is flat or that would
+			// leave nothing but a line behind
+			while (ring_count > 3) {
+				size_t ear = ring_count;
+				for (size_t i = 0; i < ring_count && ear == ring_count; ++i) {
+					const size_t before = (i + ring_count - 1) % ring_count;
+					const size_t after = (i + 1) % ring_count;
+					if (flat(ring[before], ring[i], ring[after])) {
+						continue;
+					}
+					for (size_t k = 2; k + 1 < ring_count; ++k) {
+						if (!flat(ring[before], ring[after], ring[(i + k) % ring_count])) {
+							ear = i;
+							break;
+						}
+					}
+				}
+				if (ear == ring_count) {
+					ok = false;
+					return;
+				}
+				emit(ring[(ear + ring_count - 1) % ring_count], ring[ear], ring[(ear + 1) % ring_count]);
+				for (size_t i = ear; i + 1 < ring_count; ++i) {
+					ring[i] = ring[i + 1];
+				}
+				--ring_count;
+			}
+			emit(ring[0], ring[1], ring[2]);
+		}
+
+	public:
+		constexpr BoxMesh build(const Box* boxes, size_t count, bool watertight) {
+			int high[3] = {0, 0, 0};
+			for (size_t i = 0; i < count; ++i) {
+				const int corners[2][3] = {{boxes[i].x, boxes[i].y, boxes[i].z}, {boxes[i].a, boxes[i].b, boxes[i].c}};
+				for (int axis = 0; axis < 3; ++axis) {
+					for (int k = 0; k < 2; ++k) {
+						low[axis] = i == 0 && k == 0 ? corners[k][axis] : std::min(low[axis], corners[k][axis]);
+						high[axis] = i == 0 && k == 0 ? corners[k][axis] : std::max(high[axis], corners[k][axis]);
+					}
+				}
+				ok = ok && boxes[i].part < MAX_PARTS;
+			}
+			BoxMesh mesh;
+			for (int axis = 0; axis < 3; ++axis) {
+				size[axis] = high[axis] - low[axis];
+				ok = ok && size[axis] <= MAX_CELLS;
+			}
+			if (!ok) {
+				return mesh;
+			}
+
+			for (size_t i = 0; i < count; ++i) {
+				if (!boxes[i].wedge) {
+					fill(boxes[i]);
+				}
+			}
+			for (size_t i = 0; i < count; ++i) {
+				if (boxes[i].wedge) {
+					wedge(boxes[i]);
+				}
+			}
+			for (int axis = 0; axis < 3; ++axis) {
+				for (int plane = low[axis]; plane <= high[axis]; ++plane) {
+					slice(axis, 1, plane);
+					slice(axis, -1, plane);
+				}
+			}
+
+			for (size_t i = 0; i < polygon_count; ++i) {
+				for (size_t k = 0; k < polygons[i].count; ++k) {
+					vertex(polygons[i].corners[k]);
+				}
+			}
+			for (size_t part = 0; part < MAX_PARTS; ++part) {
+				mesh.parts[part].first = uint32_t(mesh.index_count);
+				for (size_t i = 0; i < polygon_count; ++i) {
+					if (polygons[i].part == part) {
+						triangulate(polygons[i], watertight, mesh);
+					}
+				}
+				mesh.parts[part].count = uint32_t(mesh.index_count) - mesh.parts[part].first;
+				if (mesh.parts[part].count > 0) {
+					mesh.part_count = part + 1;
+				}
+			}
+
+			mesh.vertex_count = vertex_count;
+			for (size_t i = 0; i < vertex_count; ++i) {
+				for (int axis = 0; axis < 3; ++axis) {
+					mesh.positions[3 * i + axis] = float(vertices[i].c[axis]);
+				}
+			}
+			mesh.piece_count = mesh.index_count > 0 ? 1 : 0;
+			mesh.valid = ok;
+			return mesh;
+		}
+	};
+
+	// Whether two boxes overlap or touch, if only in a corner
+	constexpr bool touch(const Box& one, const Box& other) {
+		const int a[2][3] = {{one.x, one.y, one.z}, {one.a, one.b, one.c}};
+		const int b[2][3] = {{other.x, other.y, other.z}, {other.a, other.b, other.c}};
+		for (int axis = 0; axis < 3; ++axis) {
+			if (std::max(a[0][axis], a[1][axis]) < std::min(b[0][axis], b[1][axis])
+			    || std::max(b[0][axis], b[1][axis]) < std::min(a[0][axis], a[1][axis])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// The surface of the boxes of one piece on their own
+	constexpr BoxMesh meshPiece(const Box* boxes, const size_t* pieces, size_t count, size_t piece) {
+		Box chosen[MAX_BOXES] = {};
+		size_t chosen_count = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (pieces[i] == piece) {
+				chosen[chosen_count++] = boxes[i];
+			}
+		}
+		Mesher mesher;
+		return mesher.build(chosen, chosen_count, true);
+	}
+
+	constexpr size_t trianglesOf(const BoxMesh& mesh) {
+		return mesh.valid ? mesh.index_count / 3 : MAX_INDICES;
+	}
+
+	// Splits the boxes into pieces that are meshed on their own and drawn
+	// overlapping. Every box starts as a piece; while joining two touching
+	// pieces into one surface takes fewer triangles than keeping them apart,
+	// the pair that saves the most is joined. Returns the number of pieces.
+	constexpr size_t group(const Box* boxes, size_t count, size_t* pieces) {
+		size_t triangles[MAX_BOXES] = {};
+		for (size_t i = 0; i < count; ++i) {
+			pieces[i] = i;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			triangles[i] = trianglesOf(meshPiece(boxes, pieces, count, i));
+		}
+		for (;;) {
+			size_t best = 0;
+			size_t keep = 0;
+			size_t join = 0;
+			size_t joined = 0;
+			for (size_t i = 0; i < count; ++i) {
+				for (size_t j = 0; j < count; ++j) {
+					const size_t one = pieces[i];
+					const size_t other = pieces[j];
+					if (one >= other || !touch(boxes[i], boxes[j])) {
+						continue;
+					}
+					size_t trial[MAX_BOXES] = {};
+					for (size_t k = 0; k < count; ++k) {
+						trial[k] = pieces[k] == other ? one : pieces[k];
+					}
+					const size_t together = trianglesOf(meshPiece(boxes, trial, count, one));
+					if (together < triangles[one] + triangles[other] && triangles[one] + triangles[other] - together > best) {
+						best = triangles[one] + triangles[other] - together;
+						keep = one;
+						join = other;
+						joined = together;
+					}
+				}
+			}
+			if (best == 0) {
+				break;
+			}
+			for (size_t k = 0; k < count; ++k) {
+				pieces[k] = pieces[k] == join ? keep : pieces[k];
+			}
+			triangles[keep] = joined;
+		}
+
+		// Numbered from 0 in the order of their first box
+		size_t numbers[MAX_BOXES] = {};
+		size_t piece_count = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (pieces[i] == i) {
+				numbers[i] = piece_count++;
+			}
+		}
+		for (size_t i = 0; i < count; ++i) {
+			pieces[i] = numbers[pieces[i]];
+		}
+		return piece_count;
+	}
+
+	// The pieces in one mesh, part after part, sharing vertices where they meet
+	constexpr BoxMesh joinPieces(const Box* boxes, const size_t* pieces, size_t count, size_t piece_count) {
+		struct Triangle {
+			size_t part = 0;
+			size_t piece = 0;
+			uint32_t corners[3] = {0, 0, 0};
+		};
+		Triangle triangles[MAX_INDICES / 3];
+		size_t triangle_count = 0;
+		BoxMesh mesh;
+		bool ok = true;
+		for (size_t piece = 0; piece < piece_count && ok; ++piece) {
+			const BoxMesh own = meshPiece(boxes, pieces, count, piece);
+			ok = own.valid && triangle_count + own.index_count / 3 <= MAX_INDICES / 3;
+			for (size_t part = 0; part < own.part_count && ok; ++part) {
+				const BoxMesh::Range& range = own.parts[part];
+				for (size_t t = range.first / 3; t < (range.first + range.count) / 3 && ok; ++t) {
+					Triangle& triangle = triangles[triangle_count++];
+					triangle.part = part;
+					triangle.piece = piece;
+					for (int k = 0; k < 3; ++k) {
+						const float* position = own.positions + 3 * own.indices[3 * t + k];
+						size_t found = 0;
+						while (found < mesh.vertex_count && !(mesh.positions[3 * found] == position[0]
+						       && mesh.positions[3 * found + 1] == position[1] && mesh.positions[3 * found + 2] == position[2])) {
+							++found;
+						}
+						if (found == MAX_VERTICES) {
+							ok = false;
+							break;
+						}
+						if (found == mesh.vertex_count) {
+							for (int axis = 0; axis < 3; ++axis) {
+								mesh.positions[3 * found + axis] = position[axis];
+							}
+							++mesh.vertex_count;
+						}
+						triangle.corners[k] = uint32_t(found);
+					}
+				}
+			}
+		}
+		if (!ok) {
+			return BoxMesh();
+		}
+
+		for (size_t part = 0; part < MAX_PARTS; ++part) {
+			mesh.parts[part].first = uint32_t(mesh.index_count);
+			for (size_t t = 0; t < triangle_count; ++t) {
+				if (triangles[t].part != part) {
+					continue;
+				}
+				mesh.pieces[mesh.index_count / 3] = (unsigned char)triangles[t].piece;
+				for (int k = 0; k < 3; ++k) {
+					mesh.indices[mesh.index_count++] = triangles[t].corners[k];
+				}
+			}
+			mesh.parts[part].count = uint32_t(mesh.index_count) - mesh.parts[part].first;
+			if (mesh.parts[part].count > 0) {
+				mesh.part_count = part + 1;
+			}
+		}
+		mesh.piece_count = piece_count;
+		mesh.valid = true;
+		return mesh;
+	}
+
+} // namespace box_mesh
+
+
+// The surface of the union of count boxes. Watertight, it is made of closed
+// pieces (see box_mesh::group) and every edge is split where another face
+// of its piece ends on it, so no crack can open; the pieces are drawn
+// overlapping, and never take more triangles than every face of every box
+// would. Without it the boxes make one piece whose merged faces may meet in
+// T-junctions, which is only good for counting.
+constexpr BoxMesh meshBoxes(const box_mesh::Box* boxes, size_t count, bool watertight=true) {
+	using namespace box_mesh;
+	if (!watertight) {
+		Mesher mesher;
+		return mesher.build(boxes, count, false);
+	}
+	if (count > MAX_BOXES) {
+		return BoxMesh();
+	}
+	size_t pieces[MAX_BOXES] = {};
+	const size_t piece_count = group(boxes, count, pieces);
+	return joinPieces(boxes, pieces, count, piece_count);
+}
+
+#endif
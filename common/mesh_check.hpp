@@ -0,0 +1,253 @@
+#ifndef MESH_CHECK_HPP
+#define MESH_CHECK_HPP
+
+// Checks that a triangle mesh can be drawn with back faces culled: every
+// edge shared by two triangles that run along it in opposite directions,
+// and every closed piece wound counterclockwise seen from outside. Corners
+// at the same position count as one vertex whatever their indices, and an
+// edge that other triangles meet halfway along (a T-junction) is split
+// there first, so a mesh can be checked as a triangle soup.
+// checkMesh works out which triangles to turn around; the caller turns them
+// in whatever layout it keeps its mesh in.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+
+struct MeshCheck {
+	size_t triangles = 0;
+	size_t degenerate = 0;  // with no area, left out of everything else
+	size_t open_edges = 0;  // with a triangle on one side only
+	size_t non_manifold_edges = 0;  // shared by more than two triangles
+	size_t t_junctions = 0;  // edges split where other triangles meet them
+	size_t pieces = 0;  // sets of triangles joined by edges
+	size_t open_pieces = 0;
+	size_t non_orientable_pieces = 0;
+	size_t flipped = 0;
+
+	bool closed() const {
+		return open_edges == 0 && non_manifold_edges == 0 && non_orientable_pieces == 0;
+	}
+
+	void print(FILE* out, const char* name) const {
+		fprintf(out, "%s: %zu triangles, %zu pieces, %s; %zu turned around", name, triangles, pieces,
+		       closed() ? "closed" : "NOT closed", flipped);
+		if (!closed()) {
+			fprintf(out, " (%zu open edges, %zu shared by more than two, %zu pieces that cannot be oriented)",
+			       open_edges, non_manifold_edges, non_orientable_pieces);
+		}
+		if (degenerate > 0) {
+			fprintf(out, ", %zu without area", degenerate);
+		}
+		if (t_junctions > 0) {
+			fprintf(out, ", %zu T-junctions", t_junctions);
+		}
+		fprintf(out, "\n");
+	}
+};
+
+
+namespace mesh_check {
+
+	typedef std::array<float, 3> Point;
+
+	struct HalfEdge {
+		uint32_t from;
+		uint32_t to;
+		uint32_t triangle;
+	};
+
+	inline Point difference(const Point& a, const Point& b) {
+		return {{a[0] - b[0], a[1] - b[1], a[2] - b[2]}};
+	}
+
+	inline Point cross(const Point& a, const Point& b) {
+		return {{a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]}};
+	}
+
+	inline double dot(const Point& a, const Point& b) {
+		return double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2];
+	}
+
+	// Whether p lies on the segment from a to b, not at its ends
+	inline bool inside(const Point& a, const Point& b, const Point& p) {
+		const Point along = difference(b, a);
+		const Point to = difference(p, a);
+		const double length = dot(along, along);
+		const double t = dot(to, along);
+		const Point off = cross(along, to);
+		return t > 1e-6 * length && t < (1 - 1e-6) * length && dot(off, off) <= 1e-12 * length * dot(to, to);
+	}
+
+	inline std::pair<uint32_t, uint32_t> key(const HalfEdge& edge) {
+		return std::make_pair(std::min(edge.from, edge.to), std::max(edge.from, edge.to));
+	}
+
+	// Splits the edges nothing else runs along at the ends of the other such
+	// edges that lie on them; returns how many splits it made
+	inline size_t splitTJunctions(const std::vector<Point>& points, std::vector<HalfEdge>& edges) {
+		std::map<std::pair<uint32_t, uint32_t>, size_t> uses;
+		for (const HalfEdge& edge : edges) {
+			++uses[key(edge)];
+		}
+		std::vector<uint32_t> ends;
+		for (const HalfEdge& edge : edges) {
+			if (uses[key(edge)] == 1) {
+				ends.push_back(edge.from);
+				ends.push_back(edge.to);
+			}
+		}
+		std::sort(ends.begin(), ends.end());
+		ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+
+		size_t splits = 0;
+		std::vector<HalfEdge> result;
+		for (const HalfEdge& edge : edges) {
+			std::vector<std::pair<double, uint32_t>> between;
+			if (uses[key(edge)] == 1) {
+				const Point& a = points[edge.from];
+				const Point& b = points[edge.to];
+				for (uint32_t end : ends) {
+					if (end != edge.from && end != edge.to && inside(a, b, points[end])) {
+						between.emplace_back(dot(difference(points[end], a), difference(b, a)), end);
+					}
+				}
+			}
+			std::sort(between.begin(), between.end());
+			uint32_t from = edge.from;
+			for (const auto& stop : between) {
+				result.push_back(HalfEdge{from, stop.second, edge.triangle});
+				from = stop.second;
+			}
+			result.push_back(HalfEdge{from, edge.to, edge.triangle});
+			splits += between.size();
+		}
+		edges.swap(result);
+		return splits;
+	}
+
+} // namespace mesh_check
+
+
+// Checks triangle_count triangles given as three corners of x, y, z each
+// and sets flip for the ones that should be wound the other way. Triangles
+// are turned to agree with their neighbours, then closed pieces that face
+// inward as a whole are turned inside out. An open piece has no outside;
+// it keeps the winding most of its triangles already have.
+inline MeshCheck checkMesh(const float* corners, size_t triangle_count, std::vector<bool>& flip) {
+	using namespace mesh_check;
+	MeshCheck check;
+	check.triangles = triangle_count;
+	flip.assign(triangle_count, false);
+
+	// One number per position
+	std::map<Point, uint32_t> numbers;
+	std::vector<Point> points;
+	std::vector<std::array<uint32_t, 3>> triangles(triangle_count);
+	for (size_t i = 0; i < 3 * triangle_count; ++i) {
+		Point p = {{corners[3 * i], corners[3 * i + 1], corners[3 * i + 2]}};
+		auto found = numbers.emplace(p, points.size());
+		if (found.second) {
+			points.push_back(p);
+		}
+		triangles[i / 3][i % 3] = found.first->second;
+	}
+
+	std::vector<bool> used(triangle_count, false);
+	std::vector<HalfEdge> edges;
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		const auto& v = triangles[t];
+		Point normal = cross(difference(points[v[1]], points[v[0]]), difference(points[v[2]], points[v[0]]));
+		if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2] || dot(normal, normal) == 0) {
+			++check.degenerate;
+			continue;
+		}
+		used[t] = true;
+		for (int k = 0; k < 3; ++k) {
+			edges.push_back(HalfEdge{v[k], v[(k + 1) % 3], t});
+		}
+	}
+	check.t_junctions = splitTJunctions(points, edges);
+
+	// Triangles across every edge; false where they run along it the same way
+	std::map<std::pair<uint32_t, uint32_t>, std::vector<const HalfEdge*>> sides;
+	for (const HalfEdge& edge : edges) {
+		sides[key(edge)].push_back(&edge);
+	}
+	std::vector<std::vector<std::pair<uint32_t, bool>>> neighbours(triangle_count);
+	std::vector<bool> touches_open(triangle_count, false);
+	for (const auto& side : sides) {
+		const auto& along = side.second;
+		if (along.size() == 1) {
+			++check.open_edges;
+			touches_open[along[0]->triangle] = true;
+		} else if (along.size() > 2) {
+			++check.non_manifold_edges;
+			for (const HalfEdge* edge : along) {
+				touches_open[edge->triangle] = true;
+			}
+		} else if (along[0]->triangle != along[1]->triangle) {
+			bool agree = along[0]->from != along[1]->from;
+			neighbours[along[0]->triangle].emplace_back(along[1]->triangle, agree);
+			neighbours[along[1]->triangle].emplace_back(along[0]->triangle, agree);
+		}
+	}
+
+	// Walk every piece, turning triangles to match the one they were reached from
+	std::vector<bool> seen(triangle_count, false);
+	for (uint32_t start = 0; start < triangle_count; ++start) {
+		if (!used[start] || seen[start]) {
+			continue;
+		}
+		++check.pieces;
+		std::vector<uint32_t> piece(1, start);
+		seen[start] = true;
+		bool open = false;
+		bool orientable = true;
+		for (size_t i = 0; i < piece.size(); ++i) {
+			uint32_t t = piece[i];
+			open = open || touches_open[t];
+			for (const auto& next : neighbours[t]) {
+				bool turned = flip[t] != !next.second;
+				if (!seen[next.first]) {
+					seen[next.first] = true;
+					flip[next.first] = turned;
+					piece.push_back(next.first);
+				} else if (flip[next.first] != turned) {
+					orientable = false;
+				}
+			}
+		}
+
+		// Outward for closed pieces, as most of it already is for open ones
+		size_t turned = std::count_if(piece.begin(), piece.end(), [&](uint32_t t) { return flip[t]; });
+		bool inside_out = 2 * turned > piece.size();
+		if (!open && orientable) {
+			const Point& origin = points[triangles[start][0]];
+			double volume = 0;
+			for (uint32_t t : piece) {
+				const auto& v = triangles[t];
+				double signed_volume = dot(difference(points[v[0]], origin),
+				                           cross(difference(points[v[1]], origin), difference(points[v[2]], origin)));
+				volume += flip[t] ? -signed_volume : signed_volume;
+			}
+			inside_out = volume < 0;
+		}
+		if (inside_out) {
+			for (uint32_t t : piece) {
+				flip[t] = !flip[t];
+			}
+		}
+		check.open_pieces += open ? 1 : 0;
+		check.non_orientable_pieces += orientable ? 0 : 1;
+	}
+	check.flipped = std::count(flip.begin(), flip.end(), true);
+	return check;
+}
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef MESH_FILE_HPP
+#define MESH_FILE_HPP
+
+// Meshes in a binary file that is mapped and used as it is, with no parsing:
+// a header, a table of parts (a range of indices drawn in one color), vertex
+// positions as three floats each and 32-bit triangle indices. Every block
+// starts 16 bytes aligned, so the arrays can go straight to glBufferData or
+// be read in place. tools/mesh_builder writes them.
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace mesh_file {
+
+	const char MAGIC[4] = {'M', 'E', 'S', 'H'};
+	const uint32_t VERSION = 1;
+	const size_t ALIGNMENT = 16;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		// Of every block from the start of the file
+		uint64_t parts_offset;
+		uint64_t positions_offset;
+		uint64_t indices_offset;
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t part_count;
+		uint32_t reserved;
+		// Axis-aligned box and a sphere around all vertices
+		float min[3];
+		float max[3];
+		float center[3];
+		float radius;
+	};
+
+	static_assert(sizeof(Header) == 88, "Header must not have padding");
+
+	struct Part {
+		uint32_t first_index;
+		uint32_t index_count;
+		float color[3];
+		uint32_t reserved;
+	};
+
+	static_assert(sizeof(Part) == 24, "Part must not have padding");
+
+	inline size_t align(size_t offset) {
+		return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+
+} // namespace mesh_file
+
+
+// What a mesh file holds, for writing one
+struct MeshData {
+	std::vector<float> positions;  // x, y, z of every vertex
+	std::vector<uint32_t> indices;
+	std::vector<mesh_file::Part> parts;
+};
+
+// Fills in the bounds and writes data to path
+inline bool writeMeshFile(const std::string& path, const MeshData& data) {
+	using namespace mesh_file;
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.vertex_count = data.positions.size() / 3;
+	header.index_count = data.indices.size();
+	header.part_count = data.parts.size();
+	header.parts_offset = align(sizeof(Header));
+	header.positions_offset = align(header.parts_offset + sizeof(Part) * data.parts.size());
+	header.indices_offset = align(header.positions_offset + sizeof(float) * data.positions.size());
+
+	for (int c = 0; c < 3; ++c) {
+		header.min[c] = header.vertex_count > 0 ? data.positions[c] : 0;
+		header.max[c] = header.min[c];
+	}
+	for (size_t i = 0; i < data.positions.size(); ++i) {
+		header.min[i % 3] = std::min(header.min[i % 3], data.positions[i]);
+		header.max[i % 3] = std::max(header.max[i % 3], data.positions[i]);
+	}
+	for (int c = 0; c < 3; ++c) {
+		header.center[c] = (header.min[c] + header.max[c]) / 2;
+	}
+	for (size_t i = 0; i < header.vertex_count; ++i) {
+		float squared = 0;
+		for (int c = 0; c < 3; ++c) {
+			float d = data.positions[3 * i + c] - header.center[c];
+			squared += d * d;
+		}
+		header.radius = std::max(header.radius, std::sqrt(squared));
+	}
+
+	std::vector<char> file(header.indices_offset + sizeof(uint32_t) * data.indices.size(), 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + header.parts_offset, data.parts.data(), sizeof(Part) * data.parts.size());
+	memcpy(file.data() + header.positions_offset, data.positions.data(), sizeof(float) * data.positions.size());
+	memcpy(file.data() + header.indices_offset, data.indices.data(), sizeof(uint32_t) * data.indices.size());
+
+	FILE* out = fopen(path.c_str(), "wb");
+	if (out == NULL) {
+		return false;
+	}
+	bool written = fwrite(file.data(), 1, file.size(), out) == file.size();
+	return fclose(out) == 0 && written;
+}
+
+
+// A mapped mesh file; the arrays point into the mapping and live as long as it does
+class MeshFile {
+	void* data;
+	size_t size;
+
+	const char* at(uint64_t offset) const {
+		return (const char*)data + offset;
+	}
+
+	// Whether bytes from offset on lie within the file, without wrapping around
+	bool fits(uint64_t offset, uint64_t bytes) const {
+		return offset <= size && bytes <= size - offset;
+	}
+
+	// The blocks lie within the file, every index names a vertex and every
+	// part a range of the indices, so nothing read through it leaves the mapping
+	bool check() const {
+		using namespace mesh_file;
+		if (size < sizeof(Header)) {
+			return false;
+		}
+		const Header& h = header();
+		if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION
+		    || h.parts_offset % ALIGNMENT != 0 || h.positions_offset % ALIGNMENT != 0 || h.indices_offset % ALIGNMENT != 0
+		    || !fits(h.parts_offset, sizeof(Part) * uint64_t(h.part_count))
+		    || !fits(h.positions_offset, 3 * sizeof(float) * uint64_t(h.vertex_count))
+		    || !fits(h.indices_offset, sizeof(uint32_t) * uint64_t(h.index_count))) {
+			return false;
+		}
+		for (size_t i = 0; i < h.index_count; ++i) {
+			if (indices()[i] >= h.vertex_count) {
+				return false;
+			}
+		}
+		for (size_t p = 0; p < h.part_count; ++p) {
+			if (parts()[p].first_index > h.index_count || parts()[p].index_count > h.index_count - parts()[p].first_index) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+public:
+	// Check valid() before using it
+	explicit MeshFile(const std::string& path) : data(NULL), size(0) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return;
+		}
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped != MAP_FAILED) {
+				data = mapped;
+				size = info.st_size;
+			}
+		}
+		close(fd);
+		if (data != NULL && !check()) {
+			munmap(data, size);
+			data = NULL;
+			size = 0;
+		}
+	}
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	~MeshFile() {
+		if (data != NULL) {
+			munmap(data, size);
+		}
+	}
+
+	bool valid() const {
+		return data != NULL;
+	}
+
+	const mesh_file::Header& header() const {
+		return *(const mesh_file::Header*)data;
+	}
+
+	size_t vertex_count() const {
+		return header().vertex_count;
+	}
+
+	size_t index_count() const {
+		return header().index_count;
+	}
+
+	size_t part_count() const {
+		return header().part_count;
+	}
+
+	const float* positions() const {
+		return (const float*)at(header().positions_offset);
+	}
+
+	const uint32_t* indices() const {
+		return (const uint32_t*)at(header().indices_offset);
+	}
+
+	const mesh_file::Part* parts() const {
+		return (const mesh_file::Part*)at(header().parts_offset);
+	}
+};
+
+#endif
@@ -0,0 +1,431 @@
+#ifndef MESH_OPTIMIZE_HPP
+#define MESH_OPTIMIZE_HPP
+
+// Orders the triangles and vertices of an indexed mesh for drawing:
+//  - optimizeVertexCache puts triangles that share vertices next to each
+//    other, so the GPU finds most vertices already transformed (Tipsify,
+//    Sander, Nehab and Barczak 2007);
+//  - optimizeOverdraw then cuts that order into clusters where it can
+//    afford to and draws the clusters on the outside, facing out, first,
+//    so that depth testing rejects more of what is behind them;
+//  - optimizeVertexFetch numbers the vertices in the order they are first
+//    used, so that vertex data is read front to back.
+// analyzeVertexCache and analyzeOverdraw measure the result on the CPU.
+// Positions are three floats a vertex; indices may be of any unsigned type.
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+
+// Vertices transformed per triangle (ACMR) and per vertex of the mesh
+// (ATVR) with a first in, first out post-transform cache
+struct VertexCacheStats {
+	size_t triangles = 0;
+	size_t vertices = 0;
+	size_t misses = 0;
+
+	double acmr() const {
+		return triangles > 0 ? double(misses) / triangles : 0;
+	}
+
+	double atvr() const {
+		return vertices > 0 ? double(misses) / vertices : 0;
+	}
+};
+
+// Pixels shaded per pixel covered, over views of the mesh from every side
+// with back faces culled and depth tested in drawing order
+struct OverdrawStats {
+	size_t covered = 0;
+	size_t shaded = 0;
+
+	double overdraw() const {
+		return covered > 0 ? double(shaded) / covered : 0;
+	}
+};
+
+
+namespace mesh_optimize {
+
+	// First in, first out vertex cache: a vertex is in it while fewer than
+	// size vertices have been loaded since it was
+	struct Cache {
+		std::vector<uint32_t> loaded;
+		uint32_t time;
+		unsigned size;
+
+		Cache(size_t vertex_count, unsigned size) : loaded(vertex_count, 0), time(size + 1), size(size) {}
+
+		// Whether the vertex had to be loaded
+		bool use(size_t vertex) {
+			if (time - loaded[vertex] <= size) {
+				return false;
+			}
+			loaded[vertex] = time++;
+			return true;
+		}
+
+		void clear() {
+			time += size + 1;
+		}
+	};
+
+	// Triangles around every vertex: around[offsets[v]] to around[offsets[v + 1]]
+	template <typename Index>
+	void adjacency(const Index* indices, size_t index_count, size_t vertex_count,
+	               std::vector<uint32_t>& offsets, std::vector<uint32_t>& around) {
+		offsets.assign(vertex_count + 1, 0);
+		for (size_t i = 0; i < index_count; ++i) {
+			++offsets[indices[i] + 1];
+		}
+		for (size_t v = 0; v < vertex_count; ++v) {
+			offsets[v + 1] += offsets[v];
+		}
+		std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+		around.resize(index_count);
+		for (size_t i = 0; i < index_count; ++i) {
+			around[next[indices[i]]++] = i / 3;
+		}
+	}
+
+	inline void cross(const float* a, const float* b, const float* c, double* normal) {
+		double ab[3], ac[3];
+		for (int k = 0; k < 3; ++k) {
+			ab[k] = double(b[k]) - a[k];
+			ac[k] = double(c[k]) - a[k];
+		}
+		normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+		normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+		normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+	}
+
+	// Whether pixel centers exactly on the edge from a to b belong to the
+	// triangle; of two triangles sharing the edge exactly one gets them
+	inline bool owns(double dx, double dy) {
+		return dy > 0 || (dy == 0 && dx < 0);
+	}
+
+} // namespace mesh_optimize
+
+
+template <typename Index>
+VertexCacheStats analyzeVertexCache(const Index* indices, size_t index_count, size_t vertex_count,
+                                    unsigned cache_size = 16) {
+	VertexCacheStats stats;
+	stats.triangles = index_count / 3;
+	mesh_optimize::Cache cache(vertex_count, cache_size);
+	std::vector<bool> used(vertex_count, false);
+	for (size_t i = 0; i < index_count; ++i) {
+		stats.misses += cache.use(indices[i]) ? 1 : 0;
+		stats.vertices += used[indices[i]] ? 0 : 1;
+		used[indices[i]] = true;
+	}
+	return stats;
+}
+
+
+// Tipsify: triangles are emitted as fans around one vertex after another,
+// the next vertex being one of the last fan's that is still in the cache
+// and has triangles left, or failing that the latest vertex with any.
+template <typename Index>
+void optimizeVertexCache(Index* indices, size_t index_count, size_t vertex_count, unsigned cache_size = 16) {
+	if (index_count == 0) {
+		return;
+	}
+	std::vector<uint32_t> offsets, around;
+	mesh_optimize::adjacency(indices, index_count, vertex_count, offsets, around);
+	std::vector<uint32_t> live(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v) {
+		live[v] = offsets[v + 1] - offsets[v];
+	}
+
+	std::vector<uint32_t> loaded(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	std::vector<bool> emitted(index_count / 3, false);
+	std::vector<uint32_t> dead_ends, fan_vertices;
+	std::vector<Index> result;
+	result.reserve(index_count);
+	size_t next_unused = 0;
+
+	long long fan = indices[0];
+	while (fan >= 0) {
+		fan_vertices.clear();
+		for (uint32_t k = offsets[fan]; k < offsets[fan + 1]; ++k) {
+			uint32_t t = around[k];
+			if (emitted[t]) {
+				continue;
+			}
+			emitted[t] = true;
+			for (int c = 0; c < 3; ++c) {
+				Index v = indices[3 * t + c];
+				result.push_back(v);
+				dead_ends.push_back(v);
+				fan_vertices.push_back(v);
+				--live[v];
+				if (time - loaded[v] > cache_size) {
+					loaded[v] = time++;
+				}
+			}
+		}
+
+		// The vertex of the fan that will still be cached after its own
+		// fan is done and has been in the cache longest
+		fan = -1;
+		long long best = -1;
+		for (uint32_t v : fan_vertices) {
+			if (live[v] == 0) {
+				continue;
+			}
+			long long priority = 0;
+			if (time - loaded[v] + 2 * live[v] <= cache_size) {
+				priority = time - loaded[v];
+			}
+			if (priority > best) {
+				best = priority;
+				fan = v;
+			}
+		}
+		while (fan < 0 && !dead_ends.empty()) {
+			uint32_t v = dead_ends.back();
+			dead_ends.pop_back();
+			if (live[v] > 0) {
+				fan = v;
+			}
+		}
+		while (fan < 0 && next_unused < vertex_count) {
+			if (live[next_unused] > 0) {
+				fan = next_unused;
+			}
+			++next_unused;
+		}
+	}
+	std::copy(result.begin(), result.end(), indices);
+}
+
+
+// Splits the triangle order into clusters where a cluster starting with an
+// empty cache costs at most threshold times the misses of the order as it
+// is, and sorts the clusters by how far out and outward facing they are.
+// Run it after optimizeVertexCache.
+template <typename Index>
+void optimizeOverdraw(Index* indices, size_t index_count, const float* positions, size_t vertex_count,
+                      float threshold = 1.05f, unsigned cache_size = 16) {
+	using mesh_optimize::Cache;
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count < 2) {
+		return;
+	}
+
+	// The order breaks up by itself wherever all three corners miss
+	std::vector<size_t> hard(1, 0);
+	Cache cache(vertex_count, cache_size);
+	for (size_t t = 0; t < triangle_count; ++t) {
+		int misses = 0;
+		for (int c = 0; c < 3; ++c) {
+			misses += cache.use(indices[3 * t + c]) ? 1 : 0;
+		}
+		if (t > 0 && misses == 3) {
+			hard.push_back(t);
+		}
+	}
+	hard.push_back(triangle_count);
+
+	std::vector<size_t> starts;
+	for (size_t h = 0; h + 1 < hard.size(); ++h) {
+		cache.clear();
+		size_t misses = 0;
+		for (size_t i = 3 * hard[h]; i < 3 * hard[h + 1]; ++i) {
+			misses += cache.use(indices[i]) ? 1 : 0;
+		}
+		const double limit = threshold * double(misses) / (hard[h + 1] - hard[h]);
+
+		cache.clear();
+		size_t start = hard[h];
+		misses = 0;
+		starts.push_back(start);
+		for (size_t t = hard[h]; t + 1 < hard[h + 1]; ++t) {
+			for (int c = 0; c < 3; ++c) {
+				misses += cache.use(indices[3 * t + c]) ? 1 : 0;
+			}
+			if (double(misses) / (t + 1 - start) <= limit) {
+				start = t + 1;
+				starts.push_back(start);
+				misses = 0;
+				cache.clear();
+			}
+		}
+	}
+	starts.push_back(triangle_count);
+
+	// Area-weighted centers and summed normals of the mesh and of every
+	// cluster; a cluster's key is how far its center lies out along its normal
+	const size_t cluster_count = starts.size() - 1;
+	std::vector<double> sums(7 * cluster_count, 0.0);
+	double center[3] = {0, 0, 0}, area = 0;
+	for (size_t k = 0; k < cluster_count; ++k) {
+		double* sum = &sums[7 * k];
+		for (size_t t = starts[k]; t < starts[k + 1]; ++t) {
+			const float* a = positions + 3 * indices[3 * t];
+			const float* b = positions + 3 * indices[3 * t + 1];
+			const float* c = positions + 3 * indices[3 * t + 2];
+			double normal[3];
+			mesh_optimize::cross(a, b, c, normal);
+			double weight = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			for (int j = 0; j < 3; ++j) {
+				double middle = (double(a[j]) + b[j] + c[j]) / 3;
+				sum[j] += middle * weight;
+				sum[3 + j] += normal[j];
+				center[j] += middle * weight;
+			}
+			sum[6] += weight;
+			area += weight;
+		}
+	}
+	for (double& c : center) {
+		c = area > 0 ? c / area : 0;
+	}
+
+	std::vector<double> keys(cluster_count, 0.0);
+	for (size_t k = 0; k < cluster_count; ++k) {
+		const double* sum = &sums[7 * k];
+		double length = std::sqrt(sum[3] * sum[3] + sum[4] * sum[4] + sum[5] * sum[5]);
+		if (length > 0) {
+			for (int j = 0; j < 3; ++j) {
+				keys[k] += (sum[j] / sum[6] - center[j]) * sum[3 + j] / length;
+			}
+		}
+	}
+
+	std::vector<uint32_t> order(keys.size());
+	for (size_t k = 0; k < order.size(); ++k) {
+		order[k] = k;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+	std::vector<Index> result;
+	result.reserve(3 * triangle_count);
+	for (uint32_t k : order) {
+		result.insert(result.end(), indices + 3 * starts[k], indices + 3 * starts[k + 1]);
+	}
+	std::copy(result.begin(), result.end(), indices);
+}
+
+
+// Renumbers vertices in the order the indices first use them and returns
+// the old number of every new one; vertices no triangle uses go last.
+// The caller moves its vertex data the same way.
+template <typename Index>
+std::vector<uint32_t> optimizeVertexFetch(Index* indices, size_t index_count, size_t vertex_count) {
+	const uint32_t none = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> renumbered(vertex_count, none);
+	std::vector<uint32_t> order;
+	order.reserve(vertex_count);
+	for (size_t i = 0; i < index_count; ++i) {
+		if (renumbered[indices[i]] == none) {
+			renumbered[indices[i]] = order.size();
+			order.push_back(indices[i]);
+		}
+		indices[i] = renumbered[indices[i]];
+	}
+	for (size_t v = 0; v < vertex_count; ++v) {
+		if (renumbered[v] == none) {
+			order.push_back(v);
+		}
+	}
+	return order;
+}
+
+
+// Rasterizes the mesh in an orthographic view along each axis and each
+// diagonal, resolution pixels across its widest side
+template <typename Index>
+OverdrawStats analyzeOverdraw(const Index* indices, size_t index_count, const float* positions,
+                              size_t vertex_count, unsigned resolution = 256) {
+	OverdrawStats stats;
+	const double s = 1 / std::sqrt(3.0);
+	const double views[][3] = {
+		{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+		{s, s, s}, {s, s, -s}, {s, -s, s}, {s, -s, -s}, {-s, s, s}, {-s, s, -s}, {-s, -s, s}, {-s, -s, -s},
+	};
+	std::vector<double> screen(3 * vertex_count);
+	std::vector<float> depth(resolution * resolution);
+	for (const auto& view : views) {
+		// Right, up and toward the camera, which looks along -view
+		double up[3] = {0, 0, 0};
+		up[std::fabs(view[1]) < 0.9 ? 1 : 2] = 1;
+		double right[3] = {up[1] * view[2] - up[2] * view[1], up[2] * view[0] - up[0] * view[2],
+		                   up[0] * view[1] - up[1] * view[0]};
+		double length = std::sqrt(right[0] * right[0] + right[1] * right[1] + right[2] * right[2]);
+		for (double& r : right) {
+			r /= length;
+		}
+		up[0] = view[1] * right[2] - view[2] * right[1];
+		up[1] = view[2] * right[0] - view[0] * right[2];
+		up[2] = view[0] * right[1] - view[1] * right[0];
+
+		double low[2] = {INFINITY, INFINITY}, high[2] = {-INFINITY, -INFINITY};
+		for (size_t v = 0; v < vertex_count; ++v) {
+			const float* p = positions + 3 * v;
+			double* q = &screen[3 * v];
+			q[0] = right[0] * p[0] + right[1] * p[1] + right[2] * p[2];
+			q[1] = up[0] * p[0] + up[1] * p[1] + up[2] * p[2];
+			q[2] = -(view[0] * p[0] + view[1] * p[1] + view[2] * p[2]);
+			for (int j = 0; j < 2; ++j) {
+				low[j] = std::min(low[j], q[j]);
+				high[j] = std::max(high[j], q[j]);
+			}
+		}
+		double scale = resolution / std::max(std::max(high[0] - low[0], high[1] - low[1]), 1e-30);
+		for (size_t v = 0; v < vertex_count; ++v) {
+			screen[3 * v] = (screen[3 * v] - low[0]) * scale;
+			screen[3 * v + 1] = (screen[3 * v + 1] - low[1]) * scale;
+		}
+
+		std::fill(depth.begin(), depth.end(), INFINITY);
+		for (size_t i = 0; i + 2 < index_count; i += 3) {
+			const double* a = &screen[3 * indices[i]];
+			const double* b = &screen[3 * indices[i + 1]];
+			const double* c = &screen[3 * indices[i + 2]];
+			double area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+			if (area <= 0) {
+				continue;
+			}
+			int x0 = std::max(0, int(std::floor(std::min({a[0], b[0], c[0]}))));
+			int x1 = std::min(int(resolution) - 1, int(std::ceil(std::max({a[0], b[0], c[0]}))));
+			int y0 = std::max(0, int(std::floor(std::min({a[1], b[1], c[1]}))));
+			int y1 = std::min(int(resolution) - 1, int(std::ceil(std::max({a[1], b[1], c[1]}))));
+			const double* corners[3] = {a, b, c};
+			for (int y = y0; y <= y1; ++y) {
+				for (int x = x0; x <= x1; ++x) {
+					double px = x + 0.5, py = y + 0.5;
+					double weights[3];
+					bool inside = true;
+					for (int k = 0; k < 3 && inside; ++k) {
+						const double* from = corners[(k + 1) % 3];
+						const double* to = corners[(k + 2) % 3];
+						double dx = to[0] - from[0], dy = to[1] - from[1];
+						weights[k] = dx * (py - from[1]) - dy * (px - from[0]);
+						inside = weights[k] > 0 || (weights[k] == 0 && mesh_optimize::owns(dx, dy));
+					}
+					if (!inside) {
+						continue;
+					}
+					float z = float((weights[0] * a[2] + weights[1] * b[2] + weights[2] * c[2]) / area);
+					float& stored = depth[y * resolution + x];
+					if (z < stored) {
+						stored = z;
+						++stats.shaded;
+					}
+				}
+			}
+		}
+		for (float z : depth) {
+			stats.covered += z < INFINITY ? 1 : 0;
+		}
+	}
+	return stats;
+}
+
+#endif
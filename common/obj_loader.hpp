@@ -0,0 +1,449 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+// Wavefront OBJ import for meshes too big to paste into the source. The file
+// is mapped, cut at line breaks into one piece per thread and every piece is
+// parsed on its own with std::from_chars; only v, vt, vn and f lines are read.
+// Polygons become triangle fans. Corners that name the same v/vt/vn triple
+// then share one vertex: the triples are hashed into one table per thread,
+// each table owning the triples whose hash falls to it, and vertices are
+// numbered in the order they first appear so the index buffer stays local.
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <array>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// An indexed triangle mesh; the attributes the file does not have are empty
+struct ObjMesh {
+	std::vector<float> positions;  // x, y, z of every vertex
+	std::vector<float> texcoords;  // u, v of every vertex
+	std::vector<float> normals;    // x, y, z of every vertex
+	std::vector<uint32_t> indices;
+
+	size_t vertexCount() const {
+		return positions.size() / 3;
+	}
+};
+
+// Milliseconds spent on each step of a load
+struct ObjLoadStats {
+	size_t bytes;
+	size_t corners;  // three per triangle, before deduplication
+	double parse_ms;
+	double merge_ms;
+	double dedupe_ms;
+};
+
+
+namespace obj_loader {
+
+	// Index of a corner that has no texture coordinate or normal
+	const int32_t NONE = INT32_MIN;
+	// Negative (relative) indices are kept relative to the start of their piece
+	// until the pieces are joined; they are stored shifted below zero by this much
+	const int32_t RELATIVE = 1 << 30;
+
+	struct Corner {
+		int32_t v, t, n;
+
+		bool operator==(const Corner& other) const {
+			return v == other.v && t == other.t && n == other.n;
+		}
+	};
+
+	// What one thread read from its piece of the file
+	struct Piece {
+		const char* begin;
+		const char* end;
+		std::vector<float> positions;
+		std::vector<float> texcoords;
+		std::vector<float> normals;
+		std::vector<Corner> corners;
+		const char* error;  // where parsing stopped, NULL if it did not
+	};
+
+	inline double since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Runs work(0) .. work(count - 1), one call per thread
+	template<typename Work>
+	void parallel(size_t count, Work work) {
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < count; ++i) {
+			workers.emplace_back(work, i);
+		}
+		work(0);
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	inline const char* skipSpaces(const char* p, const char* end) {
+		while (p < end && (*p == ' ' || *p == '\t')) {
+			++p;
+		}
+		return p;
+	}
+
+	// Reads up to count floats, leaving the rest 0; false if there is none
+	inline bool parseFloats(const char* p, const char* end, int count, std::vector<float>& out) {
+		float values[3] = {0, 0, 0};
+		int read = 0;
+		for (; read < count; ++read) {
+			p = skipSpaces(p, end);
+			if (p < end && *p == '+') {
+				++p;
+			}
+			std::from_chars_result result = std::from_chars(p, end, values[read]);
+			if (result.ec != std::errc()) {
+				break;
+			}
+			p = result.ptr;
+		}
+		out.insert(out.end(), values, values + count);
+		return read > 0;
+	}
+
+	// One index of a face corner, made zero-based; seen is how many of that
+	// attribute the piece has read so far
+	inline bool parseIndex(const char*& p, const char* end, size_t seen, int32_t& index) {
+		int value = 0;
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc() || value == 0) {
+			return false;
+		}
+		p = result.ptr;
+		index = value > 0 ? value - 1 : int32_t(seen) + value - RELATIVE;
+		return true;
+	}
+
+	inline bool parseFace(const char* p, const char* end, Piece& piece) {
+		const size_t positions = piece.positions.size() / 3;
+		const size_t texcoords = piece.texcoords.size() / 2;
+		const size_t normals = piece.normals.size() / 3;
+		Corner first = {0, 0, 0};
+		Corner previous = {0, 0, 0};
+		int count = 0;
+		for (p = skipSpaces(p, end); p < end; p = skipSpaces(p, end)) {
+			Corner corner = {0, NONE, NONE};
+			if (!parseIndex(p, end, positions, corner.v)) {
+				return false;
+			}
+			if (p < end && *p == '/') {
+				++p;
+				if (p < end && *p != '/' && !parseIndex(p, end, texcoords, corner.t)) {
+					return false;
+				}
+				if (p < end && *p == '/') {
+					++p;
+					if (!parseIndex(p, end, normals, corner.n)) {
+						return false;
+					}
+				}
+			}
+			if (count == 0) {
+				first = corner;
+			} else if (count >= 2) {
+				piece.corners.push_back(first);
+				piece.corners.push_back(previous);
+				piece.corners.push_back(corner);
+			}
+			previous = corner;
+			++count;
+		}
+		return count >= 3;
+	}
+
+	inline void parse(Piece& piece) {
+		piece.error = NULL;
+		const char* p = piece.begin;
+		while (p < piece.end) {
+			const char* line = p;
+			const char* next = (const char*)memchr(p, '\n', piece.end - p);
+			const char* end = next != NULL ? next : piece.end;
+			p = next != NULL ? next + 1 : piece.end;
+			if (end > line && end[-1] == '\r') {
+				--end;
+			}
+			line = skipSpaces(line, end);
+			if (end - line < 2 || (line[1] != ' ' && line[1] != '\t' && line[1] != 't' && line[1] != 'n')) {
+				continue;
+			}
+
+			bool ok = true;
+			if (line[0] == 'v' && line[1] == 't') {
+				ok = parseFloats(line + 2, end, 2, piece.texcoords);
+			} else if (line[0] == 'v' && line[1] == 'n') {
+				ok = parseFloats(line + 2, end, 3, piece.normals);
+			} else if (line[0] == 'v') {
+				ok = parseFloats(line + 1, end, 3, piece.positions);
+			} else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+				ok = parseFace(line + 1, end, piece);
+			}
+			if (!ok) {
+				piece.error = line;
+				return;
+			}
+		}
+	}
+
+	// Makes an index from a piece global, or false if it points outside the file
+	inline bool resolve(int32_t& index, size_t offset, size_t total, bool optional) {
+		if (index == NONE) {
+			return optional;
+		}
+		int64_t global = index < 0 ? int64_t(offset) + index + RELATIVE : index;
+		if (global < 0 || uint64_t(global) >= total) {
+			return false;
+		}
+		index = int32_t(global);
+		return true;
+	}
+
+	inline uint32_t hash(const Corner& c) {
+		uint32_t h = uint32_t(c.v) * 0x9E3779B1u ^ uint32_t(c.t) * 0x85EBCA77u ^ uint32_t(c.n) * 0xC2B2AE3Du;
+		h ^= h >> 16;
+		h *= 0x7FEB352Du;
+		return h ^ (h >> 15);
+	}
+
+	// Table of the triples owned by one thread: the first corner that had each
+	class FirstCorners {
+		struct Slot {
+			Corner key;
+			uint32_t first;
+		};
+
+		static const uint32_t EMPTY = UINT32_MAX;
+
+		std::vector<Slot> slots;
+		size_t used;
+
+		void grow() {
+			std::vector<Slot> old(2 * slots.size(), Slot{{0, 0, 0}, EMPTY});
+			old.swap(slots);
+			const size_t mask = slots.size() - 1;
+			for (const Slot& slot : old) {
+				if (slot.first != EMPTY) {
+					size_t s = hash(slot.key) & mask;
+					while (slots[s].first != EMPTY) {
+						s = (s + 1) & mask;
+					}
+					slots[s] = slot;
+				}
+			}
+		}
+
+	public:
+		explicit FirstCorners(size_t expected) : used(0) {
+			size_t capacity = 16;
+			while (capacity < 2 * expected) {
+				capacity *= 2;
+			}
+			slots.assign(capacity, Slot{{0, 0, 0}, EMPTY});
+		}
+
+		// The first corner seen with this triple, which is index if there was none
+		uint32_t find(const Corner& corner, uint32_t h, uint32_t index) {
+			if (2 * used >= slots.size()) {
+				grow();
+			}
+			const size_t mask = slots.size() - 1;
+			for (size_t s = h & mask;; s = (s + 1) & mask) {
+				if (slots[s].first == EMPTY) {
+					slots[s] = Slot{corner, index};
+					++used;
+					return index;
+				}
+				if (slots[s].key == corner) {
+					return slots[s].first;
+				}
+			}
+		}
+	};
+
+	// For every corner, the first corner with the same triple. The high bits
+	// of its hash pick the thread that handles a corner, the low ones the slot.
+	inline void findFirsts(const std::vector<Corner>& corners, size_t threads, std::vector<uint32_t>& firsts) {
+		firsts.resize(corners.size());
+		parallel(threads, [&](size_t thread) {
+			// Closed meshes have about one vertex for every six corners
+			FirstCorners table(corners.size() / threads / 6);
+			for (size_t i = 0; i < corners.size(); ++i) {
+				uint32_t h = hash(corners[i]);
+				if ((h >> 24) % threads == thread) {
+					firsts[i] = table.find(corners[i], h, i);
+				}
+			}
+		});
+	}
+
+} // namespace obj_loader
+
+
+// Loads the triangles of an OBJ file into mesh. Returns false and says why on
+// stderr if the file cannot be read or is not a mesh.
+inline bool loadOBJ(const char* path, ObjMesh& mesh, unsigned threads=std::thread::hardware_concurrency(),
+                    ObjLoadStats* stats=NULL) {
+	using namespace obj_loader;
+	auto start = std::chrono::steady_clock::now();
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s could not be opened.\n", path);
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		fprintf(stderr, "%s is empty.\n", path);
+		close(fd);
+		return false;
+	}
+	const size_t size = info.st_size;
+	void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		fprintf(stderr, "%s could not be mapped.\n", path);
+		return false;
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	const char* text = (const char*)mapped;
+
+	// Pieces of at least a megabyte, each ending after a line break
+	threads = std::max<size_t>(1, std::min<size_t>(threads, size >> 20));
+	std::vector<Piece> pieces(threads);
+	const char* begin = text;
+	for (unsigned i = 0; i < threads; ++i) {
+		const char* end = text + size * (i + 1) / threads;
+		const char* newline = end < text + size ? (const char*)memchr(end, '\n', text + size - end) : NULL;
+		end = newline != NULL ? newline + 1 : text + size;
+		pieces[i].begin = begin;
+		pieces[i].end = std::max(begin, end);
+		begin = pieces[i].end;
+	}
+	parallel(threads, [&](size_t i) {
+		parse(pieces[i]);
+	});
+	for (const Piece& piece : pieces) {
+		if (piece.error != NULL) {
+			const char* line_end = (const char*)memchr(piece.error, '\n', piece.end - piece.error);
+			int length = std::min<int>(line_end != NULL ? line_end - piece.error : piece.end - piece.error, 80);
+			fprintf(stderr, "%s: cannot read \"%.*s\"\n", path, length, piece.error);
+			munmap(mapped, size);
+			return false;
+		}
+	}
+	double parse_ms = since(start);
+
+	// Join the pieces, turning their indices into ones into the whole file
+	start = std::chrono::steady_clock::now();
+	std::vector<size_t> first_corner(threads + 1, 0);
+	size_t total[3] = {0, 0, 0};
+	std::vector<float> positions, texcoords, normals;
+	std::vector<std::array<size_t, 3>> offsets(threads);
+	for (unsigned i = 0; i < threads; ++i) {
+		offsets[i] = {total[0], total[1], total[2]};
+		total[0] += pieces[i].positions.size() / 3;
+		total[1] += pieces[i].texcoords.size() / 2;
+		total[2] += pieces[i].normals.size() / 3;
+		first_corner[i + 1] = first_corner[i] + pieces[i].corners.size();
+	}
+	std::atomic<bool> in_range(true);
+	parallel(threads, [&](size_t i) {
+		for (Corner& corner : pieces[i].corners) {
+			if (!resolve(corner.v, offsets[i][0], total[0], false)
+			    || !resolve(corner.t, offsets[i][1], total[1], true)
+			    || !resolve(corner.n, offsets[i][2], total[2], true)) {
+				in_range = false;
+			}
+		}
+	});
+	std::vector<Corner> corners;
+	if (threads == 1) {
+		corners.swap(pieces[0].corners);
+	} else {
+		corners.resize(first_corner[threads]);
+		parallel(threads, [&](size_t i) {
+			std::copy(pieces[i].corners.begin(), pieces[i].corners.end(), corners.begin() + first_corner[i]);
+			std::vector<Corner>().swap(pieces[i].corners);
+		});
+	}
+	if (!in_range) {
+		fprintf(stderr, "%s: a face uses a vertex the file does not have.\n", path);
+		munmap(mapped, size);
+		return false;
+	}
+	auto join = [&](std::vector<float> Piece::*attribute, std::vector<float>& joined) {
+		if (threads == 1) {
+			joined.swap(pieces[0].*attribute);
+			return;
+		}
+		for (Piece& piece : pieces) {
+			joined.insert(joined.end(), (piece.*attribute).begin(), (piece.*attribute).end());
+			std::vector<float>().swap(piece.*attribute);
+		}
+	};
+	join(&Piece::positions, positions);
+	join(&Piece::texcoords, texcoords);
+	join(&Piece::normals, normals);
+	munmap(mapped, size);
+	double merge_ms = since(start);
+
+	// One vertex for every distinct triple, in the order they first appear
+	start = std::chrono::steady_clock::now();
+	std::vector<uint32_t>& indices = mesh.indices;
+	findFirsts(corners, threads, indices);
+	std::vector<uint32_t> firsts_of_vertices;
+	uint32_t count = 0;
+	for (size_t i = 0; i < indices.size(); ++i) {
+		// The first corner has index i and has been numbered already otherwise
+		if (indices[i] == i) {
+			indices[i] = count++;
+			firsts_of_vertices.push_back(i);
+		} else {
+			indices[i] = indices[indices[i]];
+		}
+	}
+	const bool textured = !texcoords.empty();
+	const bool lit = !normals.empty();
+	mesh.positions.resize(3 * size_t(count));
+	mesh.texcoords.assign(textured ? 2 * size_t(count) : 0, 0.0f);
+	mesh.normals.assign(lit ? 3 * size_t(count) : 0, 0.0f);
+	parallel(threads, [&](size_t thread) {
+		for (size_t vertex = count * thread / threads; vertex < count * (thread + 1) / threads; ++vertex) {
+			const Corner& corner = corners[firsts_of_vertices[vertex]];
+			memcpy(&mesh.positions[3 * vertex], &positions[3 * size_t(corner.v)], 3 * sizeof(float));
+			if (textured && corner.t != NONE) {
+				memcpy(&mesh.texcoords[2 * vertex], &texcoords[2 * size_t(corner.t)], 2 * sizeof(float));
+			}
+			if (lit && corner.n != NONE) {
+				memcpy(&mesh.normals[3 * vertex], &normals[3 * size_t(corner.n)], 3 * sizeof(float));
+			}
+		}
+	});
+
+	if (stats != NULL) {
+		stats->bytes = size;
+		stats->corners = corners.size();
+		stats->parse_ms = parse_ms;
+		stats->merge_ms = merge_ms;
+		stats->dedupe_ms = since(start);
+	}
+	return true;
+}
+
+#endif
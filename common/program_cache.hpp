@@ -0,0 +1,286 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+// Same as LoadShaders, but a program linked once is kept on disk as the
+// driver's own binary and loaded with glProgramBinary on later launches,
+// which skips compiling and linking GLSL altogether. A binary is looked up
+// by a hash of both sources, the defines and the driver (vendor, renderer
+// and version), so editing a shader or updating the driver just misses the
+// cache. Binaries go to $OGL_SHADER_CACHE, or $XDG_CACHE_HOME/ogl-shaders,
+// or ~/.cache/ogl-shaders; OGL_SHADER_CACHE= (empty) turns the cache off.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <initializer_list>
+#include <chrono>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <GL/glew.h>
+
+#include "resource_path.hpp"
+
+
+struct ShaderCacheStats {
+	size_t programs;
+	size_t hits;
+	double ms;  // spent loading programs, whether from source or from the cache
+};
+
+inline ShaderCacheStats& shaderCacheStats() {
+	static ShaderCacheStats stats = {0, 0, 0};
+	return stats;
+}
+
+inline void printShaderCacheStats() {
+	const ShaderCacheStats& stats = shaderCacheStats();
+	printf("shaders: %zu programs in %.1f ms, %zu from the cache\n", stats.programs, stats.ms, stats.hits);
+}
+
+
+namespace program_cache {
+
+	inline bool readFile(const char* path, std::string& text) {
+		FILE* file = fopen(path, "rb");
+		if (file == NULL) {
+			return false;
+		}
+		char chunk[4096];
+		size_t read;
+		while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+			text.append(chunk, read);
+		}
+		fclose(file);
+		return true;
+	}
+
+	// FNV-1a, with the length of every part mixed in so parts cannot run into each other
+	inline uint64_t hash(uint64_t h, const std::string& part) {
+		uint64_t length = part.size();
+		for (size_t i = 0; i < sizeof(length); ++i) {
+			h = (h ^ ((length >> (8 * i)) & 0xff)) * 1099511628211ull;
+		}
+		for (unsigned char c : part) {
+			h = (h ^ c) * 1099511628211ull;
+		}
+		return h;
+	}
+
+	inline std::string glString(GLenum name) {
+		const GLubyte* text = glGetString(name);
+		return text ? std::string((const char*)text) : std::string();
+	}
+
+	// $variable, or name under the user's cache directory
+	inline std::string directory(const char* variable, const char* name) {
+		if (const char* dir = getenv(variable)) {
+			return dir;
+		}
+		if (const char* xdg = getenv("XDG_CACHE_HOME")) {
+			return std::string(xdg) + "/" + name;
+		}
+		if (const char* home = getenv("HOME")) {
+			return std::string(home) + "/.cache/" + name;
+		}
+		return "";
+	}
+
+	// mkdir -p
+	inline bool makeDirectories(const std::string& path) {
+		for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+			std::string prefix = path.substr(0, slash);
+			if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+				return false;
+			}
+			if (slash == std::string::npos) {
+				return true;
+			}
+		}
+	}
+
+	// Defines go right after the #version line, which has to stay first
+	inline std::string withDefines(const std::string& source, const std::string& defines) {
+		if (defines.empty()) {
+			return source;
+		}
+		size_t start = 0;
+		if (source.compare(0, 8, "#version") == 0) {
+			start = source.find('\n');
+			start = start == std::string::npos ? source.size() : start + 1;
+		}
+		return source.substr(0, start) + defines + "\n" + source.substr(start);
+	}
+
+	inline GLuint compile(GLenum type, const std::string& source, const char* path) {
+		GLuint shader = glCreateShader(type);
+		const char* text = source.c_str();
+		glShaderSource(shader, 1, &text, NULL);
+		glCompileShader(shader);
+
+		GLint length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+		if (length > 1) {
+			std::vector<char> log(length);
+			glGetShaderInfoLog(shader, length, NULL, log.data());
+			printf("%s: %s\n", path, log.data());
+		}
+		return shader;
+	}
+
+	struct Header {
+		char magic[8];
+		uint32_t format;
+		uint32_t length;
+	};
+
+	const char MAGIC[8] = {'O', 'G', 'L', 'P', 'R', 'O', 'G', '1'};
+
+	inline GLuint load(const std::string& path) {
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == NULL) {
+			return 0;
+		}
+		Header header;
+		std::vector<char> binary;
+		bool read = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0;
+		if (read) {
+			binary.resize(header.length);
+			read = fread(binary.data(), 1, binary.size(), file) == binary.size();
+		}
+		fclose(file);
+		if (!read) {
+			remove(path.c_str());
+			return 0;
+		}
+
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, header.format, binary.data(), header.length);
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked != GL_TRUE) {
+			// The driver no longer takes it (an update it could not tell apart, say)
+			while (glGetError() != GL_NO_ERROR) {}
+			glDeleteProgram(program);
+			remove(path.c_str());
+			return 0;
+		}
+		return program;
+	}
+
+	inline void store(const std::string& path, GLuint program) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
+		}
+		std::vector<char> binary(length);
+		Header header;
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		GLenum format = 0;
+		glGetProgramBinary(program, length, NULL, &format, binary.data());
+		header.format = format;
+		header.length = length;
+
+		// Written aside and renamed, so another instance never reads half a file
+		std::string temporary = path + "." + std::to_string(getpid());
+		FILE* file = fopen(temporary.c_str(), "wb");
+		if (file == NULL) {
+			return;
+		}
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		            && fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+		written = fclose(file) == 0 && written;
+		if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+			remove(temporary.c_str());
+		}
+	}
+
+	inline bool supported() {
+		if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1) {
+			return false;
+		}
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+
+} // namespace program_cache
+
+
+// defines, e.g. "#define INSTANCED 1", are put into both shaders
+inline GLuint LoadShadersCached(const char* vertex_file_path, const char* fragment_file_path,
+                                const std::string& defines = "") {
+	using namespace program_cache;
+	auto start = std::chrono::steady_clock::now();
+	ShaderCacheStats& stats = shaderCacheStats();
+	++stats.programs;
+
+	std::string vertex_source;
+	std::string fragment_source;
+	if (!readFile(vertex_file_path, vertex_source)) {
+		printf("Impossible to open %s. Are you in the right directory?\n", vertex_file_path);
+		return 0;
+	}
+	if (!readFile(fragment_file_path, fragment_source)) {
+		printf("Impossible to open %s. Are you in the right directory?\n", fragment_file_path);
+		return 0;
+	}
+
+	std::string cached;
+	const std::string dir = supported() ? directory("OGL_SHADER_CACHE", "ogl-shaders") : std::string();
+	if (!dir.empty()) {
+		uint64_t key = 14695981039346656037ull;
+		for (const std::string& part : {vertex_source, fragment_source, defines, glString(GL_VENDOR),
+		                                glString(GL_RENDERER), glString(GL_VERSION)}) {
+			key = hash(key, part);
+		}
+		char name[32];
+		snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+		cached = dir + name;
+
+		GLuint program = load(cached);
+		if (program != 0) {
+			++stats.hits;
+			stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return program;
+		}
+	}
+
+	GLuint vertex = compile(GL_VERTEX_SHADER, withDefines(vertex_source, defines), vertex_file_path);
+	GLuint fragment = compile(GL_FRAGMENT_SHADER, withDefines(fragment_source, defines), fragment_file_path);
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	if (!cached.empty()) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	GLint length = 0;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+	if (length > 1) {
+		std::vector<char> log(length);
+		glGetProgramInfoLog(program, length, NULL, log.data());
+		printf("%s\n", log.data());
+	}
+	glDetachShader(program, vertex);
+	glDetachShader(program, fragment);
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	if (linked == GL_TRUE && !cached.empty() && makeDirectories(dir)) {
+		store(cached, program);
+	}
+	stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return program;
+}
+
+#endif
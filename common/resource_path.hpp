@@ -0,0 +1,34 @@
+#ifndef RESOURCE_PATH_HPP
+#define RESOURCE_PATH_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// Where a file shipped next to a program is: under $OGL_RESOURCE_DIR when
+// that is set, otherwise next to the executable, otherwise in the working directory.
+inline std::string resourcePath(const std::string& name) {
+	if (!name.empty() && name[0] == '/') {
+		return name;
+	}
+	if (const char* dir = getenv("OGL_RESOURCE_DIR")) {
+		return std::string(dir) + "/" + name;
+	}
+	char exe[4096];
+	ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+	if (length > 0) {
+		exe[length] = 0;
+		std::string beside = std::string(exe, strrchr(exe, '/') + 1) + name;
+		struct stat info;
+		if (stat(beside.c_str(), &info) == 0) {
+			return beside;
+		}
+	}
+	return name;
+}
+
+#endif
@@ -0,0 +1,458 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+// Textures that load in the background. The first time an image is seen it
+// is decoded (only uncompressed BMP so far), its whole mip chain is built and
+// the result is written to a cache file laid out the way glTexImage2D takes
+// it: BGRA, tightly packed, one level after another. Where the driver can
+// sample S3TC the levels are stored BC1 compressed instead (BC3 for images
+// with alpha), an eighth of the bytes to upload and to read. Later launches only map
+// that file. Either way the work happens on a loader thread; the GL thread
+// gets a placeholder texture right away and, in poll(), copies finished images
+// into a pixel buffer object the driver uploads from on its own time. Startup
+// and the first frame therefore do not wait for any texture.
+// Cache files go to $OGL_TEXTURE_CACHE, or $XDG_CACHE_HOME/ogl-textures, or
+// ~/.cache/ogl-textures, named by a hash of the image path, size and modification time.
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <GL/glew.h>
+
+#include "program_cache.hpp"
+#include "bc_encoder.hpp"
+
+
+namespace texture_cache {
+
+	const int MAX_LEVELS = 16;
+
+	struct Header {
+		char magic[8];
+		uint32_t width;
+		uint32_t height;
+		uint32_t levels;
+		uint32_t format;
+		uint64_t offsets[MAX_LEVELS];  // of every level from the start of the file
+	};
+
+	const char MAGIC[8] = {'O', 'G', 'L', 'T', 'E', 'X', '0', '2'};
+
+	enum Format {
+		BGRA8,
+		BC1,
+		BC3,
+	};
+
+	inline uint32_t levelSize(uint32_t size, uint32_t level) {
+		size >>= level;
+		return size > 0 ? size : 1;
+	}
+
+	inline size_t levelBytes(uint32_t format, uint32_t width, uint32_t height) {
+		if (format == BGRA8) {
+			return size_t(width) * height * 4;
+		}
+		return bc::encodedSize(width, height, format == BC3);
+	}
+
+	// Rows bottom up, BGRA, like GL wants them; false if it is not a BMP we read
+	inline bool decodeBMP(const char* path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& pixels) {
+		std::string data;
+		if (!program_cache::readFile(path, data) || data.size() < 54 || data[0] != 'B' || data[1] != 'M') {
+			return false;
+		}
+		const uint8_t* bytes = (const uint8_t*)data.data();
+		auto u32 = [&](size_t at) { uint32_t v; memcpy(&v, bytes + at, 4); return v; };
+		auto u16 = [&](size_t at) { uint16_t v; memcpy(&v, bytes + at, 2); return v; };
+
+		const uint32_t start = u32(10);
+		const int32_t signed_height = (int32_t)u32(22);
+		const uint16_t bits = u16(28);
+		const uint32_t compression = u32(30);
+		width = u32(18);
+		height = signed_height < 0 ? -signed_height : signed_height;
+		if ((bits != 24 && bits != 32) || (compression != 0 && compression != 3) || width == 0 || height == 0) {
+			return false;
+		}
+		const size_t pixel_bytes = bits / 8;
+		const size_t stride = (width * pixel_bytes + 3) & ~size_t(3);
+		if (start + stride * height > data.size()) {
+			return false;
+		}
+
+		pixels.resize(size_t(width) * height * 4);
+		for (uint32_t y = 0; y < height; ++y) {
+			// A negative height means the rows are stored top down
+			const uint32_t row = signed_height < 0 ? height - 1 - y : y;
+			const uint8_t* in = bytes + start + stride * row;
+			uint8_t* out = &pixels[size_t(y) * width * 4];
+			for (uint32_t x = 0; x < width; ++x, in += pixel_bytes, out += 4) {
+				out[0] = in[0];
+				out[1] = in[1];
+				out[2] = in[2];
+				out[3] = bits == 32 ? in[3] : 255;
+			}
+		}
+		return true;
+	}
+
+	// The next level down, each texel the average of up to four above it
+	inline void downsample(const uint8_t* in, uint32_t width, uint32_t height, uint8_t* out) {
+		const uint32_t out_width = levelSize(width, 1);
+		const uint32_t out_height = levelSize(height, 1);
+		for (uint32_t y = 0; y < out_height; ++y) {
+			const uint32_t y0 = std::min(2 * y, height - 1);
+			const uint32_t y1 = std::min(2 * y + 1, height - 1);
+			for (uint32_t x = 0; x < out_width; ++x) {
+				const uint32_t x0 = std::min(2 * x, width - 1);
+				const uint32_t x1 = std::min(2 * x + 1, width - 1);
+				for (int c = 0; c < 4; ++c) {
+					unsigned sum = in[(size_t(y0) * width + x0) * 4 + c] + in[(size_t(y0) * width + x1) * 4 + c]
+					             + in[(size_t(y1) * width + x0) * 4 + c] + in[(size_t(y1) * width + x1) * 4 + c];
+					out[(size_t(y) * out_width + x) * 4 + c] = uint8_t((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	// Decodes the image and lays it out with all of its levels the way a cache file has it
+	inline bool build(const char* image_path, bool compress, std::vector<uint8_t>& image) {
+		Header header;
+		std::vector<uint8_t> pixels;
+		if (!decodeBMP(image_path, header.width, header.height, pixels)) {
+			return false;
+		}
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.format = BGRA8;
+		header.levels = 1;
+		while (header.levels < MAX_LEVELS
+		       && (levelSize(header.width, header.levels - 1) > 1 || levelSize(header.height, header.levels - 1) > 1)) {
+			++header.levels;
+		}
+
+		size_t offset = sizeof(Header);
+		size_t total = 0;
+		for (uint32_t level = 0; level < MAX_LEVELS; ++level) {
+			header.offsets[level] = 0;
+			if (level < header.levels) {
+				header.offsets[level] = offset + total;
+				total += size_t(levelSize(header.width, level)) * levelSize(header.height, level) * 4;
+			}
+		}
+		image.resize(offset + total);
+		memcpy(image.data(), &header, sizeof(header));
+		memcpy(image.data() + offset, pixels.data(), pixels.size());
+		for (uint32_t level = 1; level < header.levels; ++level) {
+			downsample(&image[header.offsets[level - 1]], levelSize(header.width, level - 1),
+			           levelSize(header.height, level - 1), &image[header.offsets[level]]);
+		}
+		if (!compress) {
+			return true;
+		}
+
+		// Every level is filtered from the full colour one above it, then compressed
+		Header compressed = header;
+		compressed.format = bc::hasAlpha(pixels.data(), header.width, header.height) ? BC3 : BC1;
+		total = 0;
+		for (uint32_t level = 0; level < header.levels; ++level) {
+			compressed.offsets[level] = offset + total;
+			total += levelBytes(compressed.format, levelSize(header.width, level), levelSize(header.height, level));
+		}
+		std::vector<uint8_t> encoded(offset + total);
+		memcpy(encoded.data(), &compressed, sizeof(compressed));
+		for (uint32_t level = 0; level < header.levels; ++level) {
+			bc::encode(&image[header.offsets[level]], levelSize(header.width, level), levelSize(header.height, level),
+			           compressed.format == BC3, &encoded[compressed.offsets[level]]);
+		}
+		image.swap(encoded);
+		return true;
+	}
+
+	inline bool store(const std::string& path, const std::vector<uint8_t>& image) {
+		// Written aside and renamed, so a reader never maps half a file
+		std::string temporary = path + "." + std::to_string(getpid());
+		FILE* file = fopen(temporary.c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+		bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+		written = fclose(file) == 0 && written;
+		if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+			remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// A cache file, mapped, or an image just built when there was no cache to write to
+	struct Image {
+		void* data;
+		size_t size;
+		bool mapped;
+		std::vector<uint8_t> built;
+
+		const Header& header() const {
+			return *(const Header*)data;
+		}
+
+		void release() {
+			if (mapped) {
+				munmap(data, size);
+			}
+			data = NULL;
+			mapped = false;
+			std::vector<uint8_t>().swap(built);
+		}
+	};
+
+	// Maps a cache file that is complete for what its header says
+	inline bool map(const std::string& path, Image& mapping) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		bool valid = fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(Header);
+		mapping.size = valid ? info.st_size : 0;
+		mapping.data = valid ? mmap(NULL, mapping.size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (mapping.data == MAP_FAILED) {
+			return false;
+		}
+
+		const Header& header = mapping.header();
+		valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.levels > 0 && header.levels <= MAX_LEVELS
+		        && header.format <= BC3;
+		if (valid) {
+			const uint32_t last = header.levels - 1;
+			valid = header.offsets[last] + levelBytes(header.format, levelSize(header.width, last),
+			                                          levelSize(header.height, last)) <= mapping.size;
+		}
+		if (!valid) {
+			munmap(mapping.data, mapping.size);
+		}
+		mapping.mapped = valid;
+		return valid;
+	}
+
+} // namespace texture_cache
+
+
+struct TextureCacheStats {
+	size_t textures;    // uploaded
+	size_t from_cache;  // of them
+	size_t compressed;  // of them
+	size_t bytes;       // of every level of all of them
+	double upload_ms;   // on the GL thread
+};
+
+class TextureCache {
+	struct Job {
+		GLuint texture;
+		std::string path;
+		texture_cache::Image image;
+		bool loaded;
+		bool from_cache;
+	};
+
+	std::thread loader;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> requests;
+	std::deque<Job> finished;
+	TextureCacheStats _stats;
+	size_t waiting;  // requested and not uploaded yet
+	bool stopping;
+	const bool compress;
+
+	void load(Job& job) {
+		using namespace texture_cache;
+		const std::string dir = program_cache::directory("OGL_TEXTURE_CACHE", "ogl-textures");
+		struct stat info;
+		if (stat(job.path.c_str(), &info) != 0) {
+			printf("Could not open %s\n", job.path.c_str());
+			job.loaded = false;
+			return;
+		}
+		uint64_t key = program_cache::hash(14695981039346656037ull, job.path);
+		key = program_cache::hash(key, std::to_string(info.st_size) + "/" + std::to_string(info.st_mtim.tv_sec)
+		                               + "." + std::to_string(info.st_mtim.tv_nsec) + (compress ? "/bc" : ""));
+		char name[32];
+		snprintf(name, sizeof(name), "/%016llx.tex", (unsigned long long)key);
+		const std::string cached = dir + name;
+
+		job.from_cache = !dir.empty() && map(cached, job.image);
+		if (job.from_cache) {
+			job.loaded = true;
+			return;
+		}
+
+		std::vector<uint8_t> image;
+		job.loaded = build(job.path.c_str(), compress, image);
+		if (!job.loaded) {
+			printf("Could not decode %s\n", job.path.c_str());
+			return;
+		}
+		if (dir.empty() || !program_cache::makeDirectories(dir) || !store(cached, image) || !map(cached, job.image)) {
+			// Works without a cache too, just not faster next time
+			job.image.built.swap(image);
+			job.image.data = job.image.built.data();
+			job.image.size = job.image.built.size();
+		}
+	}
+
+	void loader_loop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [&]() { return stopping || !requests.empty(); });
+			if (stopping) {
+				return;
+			}
+			Job job = std::move(requests.front());
+			requests.pop_front();
+			lock.unlock();
+			load(job);
+			lock.lock();
+			finished.push_back(std::move(job));
+		}
+	}
+
+	static void upload(const Job& job) {
+		using namespace texture_cache;
+		const Header& header = job.image.header();
+		const size_t start = header.offsets[0];
+		const size_t size = job.image.size - start;
+
+		// The copy into the pixel buffer is all that happens here; the
+		// texture reads from it whenever the driver gets to it
+		GLuint pbo;
+		glGenBuffers(1, &pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		void* target = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+		if (target != NULL) {
+			memcpy(target, (const char*)job.image.data + start, size);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			for (uint32_t level = 0; level < header.levels; ++level) {
+				const uint32_t width = levelSize(header.width, level);
+				const uint32_t height = levelSize(header.height, level);
+				void* offset = (void*)(header.offsets[level] - start);
+				if (header.format == BGRA8) {
+					glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, offset);
+				} else {
+					const GLenum internal = header.format == BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+					                                             : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+					glCompressedTexImage2D(GL_TEXTURE_2D, level, internal, width, height, 0,
+					                       levelBytes(header.format, width, height), offset);
+				}
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levels - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &pbo);
+	}
+
+public:
+	// By default textures are compressed when the driver can sample S3TC
+	explicit TextureCache(bool compress=GLEW_EXT_texture_compression_s3tc)
+	: _stats{0, 0, 0, 0, 0}, waiting(0), stopping(false), compress(compress) {
+		loader = std::thread(&TextureCache::loader_loop, this);
+	}
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// Needs no GL context: textures belong to whoever requested them
+	~TextureCache() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		loader.join();
+		for (Job& job : finished) {
+			job.image.release();
+		}
+	}
+
+	// GL thread: a texture that is a single grey texel until poll() has the image
+	GLuint request(const std::string& path) {
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		const uint8_t grey[4] = {128, 128, 128, 255};
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_BGRA, GL_UNSIGNED_BYTE, grey);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(Job{texture, path, texture_cache::Image{NULL, 0, false, {}}, false, false});
+			++waiting;
+		}
+		wake.notify_one();
+		return texture;
+	}
+
+	// GL thread, once a frame: uploads finished images until about
+	// budget bytes went out, but always at least one
+	void poll(size_t budget=8 << 20) {
+		size_t sent = 0;
+		while (sent < budget) {
+			Job job;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (finished.empty()) {
+					return;
+				}
+				job = std::move(finished.front());
+				finished.pop_front();
+				--waiting;
+			}
+			if (!job.loaded) {
+				continue;
+			}
+			auto start = std::chrono::steady_clock::now();
+			upload(job);
+			_stats.upload_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			sent += job.image.size;
+			++_stats.textures;
+			_stats.from_cache += job.from_cache;
+			_stats.compressed += job.image.header().format != texture_cache::BGRA8;
+			_stats.bytes += job.image.size;
+			job.image.release();
+		}
+	}
+
+	// Requested textures that do not have their image yet
+	size_t pending() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return waiting;
+	}
+
+	const TextureCacheStats& stats() const {
+		return _stats;
+	}
+};
+
+#endif
@@ -0,0 +1,214 @@
+// Builds the hamster of the hamster scene out of boxes and writes it as a
+// mesh file (see common/mesh_file.hpp). The game's cat is made of boxes too,
+// but while the game compiles (see GAME/cat.hpp). The boxes are meshed
+// in closed pieces, boxes that take fewer triangles together sharing one
+// surface (see common/box_mesh.hpp). A mesh is only written if every piece
+// is closed, without T-junctions and wound so that back faces can be culled
+// (see common/mesh_check.hpp), and if it has no more triangles than every
+// face of every box. Its triangles and vertices are then ordered for
+// drawing (see common/mesh_optimize.hpp).
+//
+// Usage: mesh_builder [--t-junctions] output.mesh
+//
+// --t-junctions makes one surface of all boxes and leaves its merged faces
+// unsplit where they meet, for comparison only: such a mesh can show
+// cracks when drawn.
+//
+// From the top of the tree:
+//   g++ -std=c++17 -O2 -I. tools/mesh_builder.cpp -o mesh_builder
+//   ./mesh_builder 3d_hamster/hamster.mesh
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <utility>
+#include <cmath>
+
+#include "common/mesh_file.hpp"
+#include "common/box_mesh.hpp"
+#include "common/mesh_check.hpp"
+#include "common/mesh_optimize.hpp"
+
+
+using box_mesh::Box;
+
+const float COLORS[3][3] = {
+    {1, 0.84f, 0},        // body
+    {1, 0.9f, 0.05f},     // head
+    {0.32f, 0.26f, 0.1f}, // ears, tail and legs
+};
+
+enum Part {
+    BODY,
+    HEAD,
+    OTHER,
+};
+
+const Box HAMSTER[] = {
+    {0, 0, 0, 8, 3, 3, false, BODY},
+    {7, 0, 3, 11, 3, 6, false, HEAD},
+    {7, 0, 6, 8, 1, 7, false, OTHER},  // ears
+    {7, 2, 6, 8, 3, 7, false, OTHER},
+    {-1, 1, 2, 0, 2, 3, false, OTHER},  // tail
+    {7, 0, -1, 8, 1, 0, false, OTHER},  // legs
+    {7, 2, -1, 8, 3, 0, false, OTHER},
+    {0, 2, -1, 1, 3, 0, false, OTHER},
+    {0, 0, -1, 1, 1, 0, false, OTHER},
+};
+
+
+// Twelve triangles a box and four a wedge, as drawn before
+size_t naive_triangles(const Box* boxes, size_t count) {
+    size_t triangles = 0;
+    for (size_t i = 0; i < count; ++i) {
+        triangles += boxes[i].wedge ? 4 : 12;
+    }
+    return triangles;
+}
+
+// The box mesher works in fixed-size arrays; copy out what it made
+MeshData build(const BoxMesh& mesh) {
+    MeshData data;
+    data.positions.assign(mesh.positions, mesh.positions + 3 * mesh.vertex_count);
+    data.indices.assign(mesh.indices, mesh.indices + mesh.index_count);
+    for (size_t i = 0; i < mesh.part_count; ++i) {
+        mesh_file::Part part;
+        memset(&part, 0, sizeof(part));
+        part.first_index = mesh.parts[i].first;
+        part.index_count = mesh.parts[i].count;
+        memcpy(part.color, COLORS[i], sizeof(part.color));
+        data.parts.push_back(part);
+    }
+    return data;
+}
+
+// Checks every piece on its own, since pieces drawn overlapping do not make
+// one closed surface together, and winds its triangles outward. The figures
+// are added up over the pieces.
+MeshCheck check_pieces(const BoxMesh& mesh, MeshData& data) {
+    MeshCheck total;
+    for (size_t piece = 0; piece < mesh.piece_count; ++piece) {
+        std::vector<size_t> triangles;
+        std::vector<float> corners;
+        for (size_t t = 0; t < data.indices.size() / 3; ++t) {
+            if (mesh.pieces[t] != piece) {
+                continue;
+            }
+            triangles.push_back(t);
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t index = data.indices[3 * t + k];
+                corners.insert(corners.end(), &data.positions[3 * index], &data.positions[3 * index + 3]);
+            }
+        }
+        std::vector<bool> flip;
+        MeshCheck check = checkMesh(corners.data(), triangles.size(), flip);
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            if (flip[i]) {
+                std::swap(data.indices[3 * triangles[i] + 1], data.indices[3 * triangles[i] + 2]);
+            }
+        }
+        total.triangles += check.triangles;
+        total.degenerate += check.degenerate;
+        total.open_edges += check.open_edges;
+        total.non_manifold_edges += check.non_manifold_edges;
+        total.t_junctions += check.t_junctions;
+        total.pieces += check.pieces;
+        total.open_pieces += check.open_pieces;
+        total.non_orientable_pieces += check.non_orientable_pieces;
+        total.flipped += check.flipped;
+    }
+    return total;
+}
+
+void print_order(const char* order, const MeshData& data) {
+    const size_t vertex_count = data.positions.size() / 3;
+    VertexCacheStats cache = analyzeVertexCache(data.indices.data(), data.indices.size(), vertex_count);
+    OverdrawStats overdraw = analyzeOverdraw(data.indices.data(), data.indices.size(), data.positions.data(), vertex_count);
+    printf("  %-10s ACMR %.3f, ATVR %.3f, overdraw %.4f\n", order, cache.acmr(), cache.atvr(), overdraw.overdraw());
+}
+
+// Orders the triangles of every part for the vertex cache and overdraw. The
+// overdraw order cuts the cache order into more clusters the higher the
+// threshold; the boxes are so few that the one with the least overdraw is
+// kept, as long as the cache does no worse than in the generated order.
+// Then the vertices are numbered in the order they are used.
+void optimize(MeshData& data) {
+    const size_t vertex_count = data.positions.size() / 3;
+    const size_t misses = analyzeVertexCache(data.indices.data(), data.indices.size(), vertex_count).misses;
+    std::vector<uint32_t> best = data.indices;
+    double least = INFINITY;
+    for (float threshold : {1.05f, 1.2f, 1.5f, 2.0f, 3.0f}) {
+        std::vector<uint32_t> indices = data.indices;
+        for (const mesh_file::Part& part : data.parts) {
+            uint32_t* first = &indices[part.first_index];
+            optimizeVertexCache(first, part.index_count, vertex_count);
+            optimizeOverdraw(first, part.index_count, data.positions.data(), vertex_count, threshold);
+        }
+        if (analyzeVertexCache(indices.data(), indices.size(), vertex_count).misses > misses) {
+            continue;
+        }
+        double overdraw = analyzeOverdraw(indices.data(), indices.size(), data.positions.data(), vertex_count).overdraw();
+        if (overdraw < least) {
+            least = overdraw;
+            best = indices;
+        }
+    }
+    data.indices = best;
+
+    std::vector<uint32_t> order = optimizeVertexFetch(data.indices.data(), data.indices.size(), vertex_count);
+    std::vector<float> positions;
+    positions.reserve(data.positions.size());
+    for (uint32_t v : order) {
+        positions.insert(positions.end(), &data.positions[3 * v], &data.positions[3 * v + 3]);
+    }
+    data.positions.swap(positions);
+}
+
+
+int main(int argc, char** argv) {
+    const bool watertight = !(argc > 1 && strcmp(argv[1], "--t-junctions") == 0);
+    if (!watertight) {
+        --argc;
+        ++argv;
+    }
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s [--t-junctions] output.mesh\n", argv[0]);
+        return 1;
+    }
+    const char* name = "hamster";
+    const Box* boxes = HAMSTER;
+    const size_t count = sizeof(HAMSTER) / sizeof(Box);
+    static BoxMesh mesh;
+    mesh = meshBoxes(boxes, count, watertight);
+    if (!mesh.valid) {
+        fprintf(stderr, "The boxes of %s do not fit the box mesher\n", name);
+        return 1;
+    }
+    MeshData data = build(mesh);
+    MeshCheck check = check_pieces(mesh, data);
+    check.print(stdout, name);
+    if (!check.closed()) {
+        fprintf(stderr, "The outside of %s has holes\n", name);
+        return 1;
+    }
+    if (watertight && check.t_junctions > 0) {
+        fprintf(stderr, "The faces of %s meet in T-junctions\n", name);
+        return 1;
+    }
+    const size_t naive = naive_triangles(boxes, count);
+    if (data.indices.size() / 3 > naive) {
+        fprintf(stderr, "%s takes %zu triangles, more than the %zu of every face of every box\n", name,
+                data.indices.size() / 3, naive);
+        return 1;
+    }
+    print_order("generated", data);
+    optimize(data);
+    print_order("optimized", data);
+    if (!writeMeshFile(argv[1], data)) {
+        fprintf(stderr, "Cannot write %s\n", argv[1]);
+        return 1;
+    }
+    printf("%s: %zu vertices, %zu triangles (%zu with every face of every box), %zu parts, %zu pieces\n", argv[1],
+           data.positions.size() / 3, data.indices.size() / 3, naive, data.parts.size(), mesh.piece_count);
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Throughput of the OBJ loader (common/obj_loader.hpp) on a generated mesh:
+// a wavy square grid with positions, texture coordinates and normals, written
+// as quads the way exporters do. The file is made once and then loaded with
+// one thread, two threads and so on up to the number of cores.
+//
+// Usage: obj_bench [megabytes] [file]
+//
+// From the top of the tree:
+//   g++ -std=c++17 -O2 -pthread -I. tools/obj_bench.cpp -o obj_bench
+//   ./obj_bench 300 /tmp/grid.obj
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include <sys/stat.h>
+
+#include "common/obj_loader.hpp"
+
+
+// About 150 bytes of OBJ per grid vertex
+bool write_grid(const char* path, size_t megabytes) {
+    const size_t side = std::max<size_t>(2, std::sqrt(megabytes * 1e6 / 150));
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        return false;
+    }
+    fprintf(out, "# %zu x %zu grid\no grid\n", side, side);
+    for (size_t i = 0; i < side; ++i) {
+        for (size_t j = 0; j < side; ++j) {
+            float x = float(i) / (side - 1), y = float(j) / (side - 1);
+            float height = 0.05f * std::sin(20 * x) * std::cos(17 * y);
+            fprintf(out, "v %.6f %.6f %.6f\n", x, y, height);
+            fprintf(out, "vt %.6f %.6f\n", x, y);
+            fprintf(out, "vn %.6f %.6f %.6f\n", -std::cos(20 * x) * std::cos(17 * y), std::sin(20 * x) * std::sin(17 * y), 1.0f);
+        }
+    }
+    for (size_t i = 0; i + 1 < side; ++i) {
+        for (size_t j = 0; j + 1 < side; ++j) {
+            size_t a = i * side + j + 1, b = a + 1, c = a + side + 1, d = a + side;
+            fprintf(out, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, b, b, b, c, c, c, d, d, d);
+        }
+    }
+    return fclose(out) == 0;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 300;
+    std::string path = argc > 2 ? argv[2] : "/tmp/obj_bench.obj";
+
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || size_t(info.st_size) < megabytes * 1000000 * 9 / 10) {
+        printf("writing %s\n", path.c_str());
+        if (!write_grid(path.c_str(), megabytes)) {
+            fprintf(stderr, "Cannot write %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    // 1, 2, 4 and so on, then once more with every core
+    for (unsigned threads = 1; threads <= cores;
+         threads = threads == cores ? cores + 1 : std::min(threads * 2, cores)) {
+        ObjMesh mesh;
+        ObjLoadStats stats;
+        auto start = std::chrono::steady_clock::now();
+        if (!loadOBJ(path.c_str(), mesh, threads, &stats)) {
+            return 1;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%2u threads: %.1f MB in %.0f ms, %.0f MB/s (parse %.0f ms, join %.0f ms, dedupe %.0f ms); "
+               "%zu corners -> %zu vertices\n",
+               threads, stats.bytes / 1e6, ms, stats.bytes / 1e3 / ms, stats.parse_ms, stats.merge_ms,
+               stats.dedupe_ms, stats.corners, mesh.vertexCount());
+    }
+    return 0;
+}
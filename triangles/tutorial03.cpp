@@ -6,7 +6,7 @@
 #include "math.h"
 #include "time.h"
 #include <glm/gtc/matrix_transform.hpp>
-#include <common/shader.hpp>
+#include <common/program_cache.hpp>
 
 GLFWwindow* window;
 using namespace glm;
@@ -50,8 +50,10 @@ int main(void) {
 
 
 
-    GLuint programID_1 = LoadShaders( "/home/imroggen/OpenGL/ogl-master/tutorial03_matrices/SimpleTransform.vertexshader", "/home/imroggen/OpenGL/ogl-master/tutorial03_matrices/SingleColor.fragmentshader" );
-    GLuint programID_2 = LoadShaders( "/home/imroggen/OpenGL/ogl-master/tutorial03_matrices/SimpleTransform.vertexshader", "/home/imroggen/OpenGL/ogl-master/tutorial03_matrices/SingleColor2.fragmentshader" );
+    // Shaders are looked up next to the executable, or under $OGL_RESOURCE_DIR
+    GLuint programID_1 = LoadShadersCached(resourcePath("SimpleTransform.vertexshader").c_str(), resourcePath("SingleColor.fragmentshader").c_str());
+    GLuint programID_2 = LoadShadersCached(resourcePath("SimpleTransform.vertexshader").c_str(), resourcePath("SingleColor2.fragmentshader").c_str());
+    printShaderCacheStats();
 
     GLuint VertexArrayID;
     glGenVertexArrays(1, &VertexArrayID);
@@ -89,6 +91,9 @@ int main(void) {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // No face culling: the camera goes round the two flat triangles and
+    // they are meant to be seen from both sides
+
     const float radius = 10.0f;
 
     do {